@@ -0,0 +1,108 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+// Compares the suffix test of AffixKernel with the std::mismatch based
+// comparison Affix::match uses for long affixes, on random Georgian words.
+
+#include "match-kernel.h"
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+using namespace xmunch;
+
+static String random_word(std::mt19937& rng, int min, int max) {
+	std::uniform_int_distribution<int> len(min, max);
+	std::uniform_int_distribution<int> letter(0, 32);
+	String w;
+	for (int i = len(rng); i > 0; i--) {
+		// U+10D0 .. U+10F0, Georgian Mkhedruli
+		int c = 0x10D0 + letter(rng);
+		w.push_back(static_cast<Char>(0xE0 | (c >> 12)));
+		w.push_back(static_cast<Char>(0x80 | ((c >> 6) & 0x3F)));
+		w.push_back(static_cast<Char>(0x80 | (c & 0x3F)));
+	}
+	return w;
+}
+
+static bool mismatch_suffix(const String& suffix, const String& s) {
+	auto m = std::mismatch(suffix.rbegin(), suffix.rend(), s.rbegin(), s.rend());
+	return m.first == suffix.rend();
+}
+
+int main(int argc, char* argv[]) {
+	size_t word_count = argc > 1 ? std::stoul(argv[1]) : 200000;
+	size_t affix_count = 40;
+
+	std::mt19937 rng(42);
+	std::vector<String> words;
+	std::vector<WordKey> keys(word_count);
+	for (size_t i = 0; i < word_count; i++) {
+		words.push_back(random_word(rng, 3, 12));
+		keys[i].set(words.back());
+	}
+
+	// Take suffixes from real words, so some of them match.
+	std::vector<String> suffixes;
+	std::vector<AffixKernel> kernels(affix_count);
+	std::uniform_int_distribution<int> pick(0, word_count - 1);
+	std::uniform_int_distribution<int> letters(1, 4);
+	for (size_t i = 0; i < affix_count; i++) {
+		const String& w = words[pick(rng)];
+		size_t l = std::min<size_t>(letters(rng) * 3, w.length());
+		suffixes.push_back(w.substr(w.length() - l));
+		kernels[i].compile(suffixes.back(), true);
+	}
+
+	typedef std::chrono::steady_clock Clock;
+
+	size_t scalar_hits = 0;
+	auto t0 = Clock::now();
+	for (auto& s : suffixes) {
+		for (auto& w : words) {
+			scalar_hits += mismatch_suffix(s, w);
+		}
+	}
+	auto t1 = Clock::now();
+
+	size_t kernel_hits = 0;
+	for (auto& k : kernels) {
+		for (size_t i = 0; i < word_count; i++) {
+			kernel_hits += k.matches(keys[i], words[i].length());
+		}
+	}
+	auto t2 = Clock::now();
+
+	double n = static_cast<double>(word_count * affix_count);
+	double scalar_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+	double kernel_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / n;
+
+	std::cout << "words: " << word_count << ", suffixes: " << affix_count << "\n"
+		<< "mismatch: " << scalar_ns << " ns/test, " << scalar_hits << " hits\n"
+		<< "kernel:   " << kernel_ns << " ns/test, " << kernel_hits << " hits\n"
+		<< "speedup:  " << scalar_ns / kernel_ns << std::endl;
+
+	if (scalar_hits != kernel_hits) {
+		std::cerr << "ERROR: kernel and mismatch results differ." << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,350 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+// Benchmarks of the hot paths of xmunch on generated Georgian-like data:
+// Affix::match per affix shape, word lookups, loading the word list and
+// premunched data, AffixGroup::countMatch, Word::format and query index
+// lookups. The results are
+// written as JSON, the best of a few repetitions each.
+// Usage: microbench [stems]
+
+#include "xmunch.h"
+#include "word.h"
+#include "affix.h"
+#include "affix-parser.h"
+#include "match-context.h"
+#include "munch.h"
+#include "output.h"
+#include "premunched-loader.h"
+#include "query-index.h"
+#include "sorted-index.h"
+#include "stats.h"
+#include "word-set.h"
+#include "wordlist-loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace xmunch;
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	const int REPETITIONS = 5;
+
+	// One affix group per shape, the word list contains their forms.
+	const char* affix_file =
+		"W/A,A!\n"
+		"PS (1) {\n.\tის\n}\n"
+		"SR (1) {\nა\tით\n}\n"
+		"PR (1) {\n.\tგა-\n}\n"
+		"CF (1) {\n. : .\tმო-ს\n}\n"
+		"GE (1) {\nა,ე\tებს\n}\n";
+
+	const char* shape_names[] = {"plain_suffix", "suffix", "prefix", "circumfix", "generic"};
+
+	String letter(int i) {
+		// U+10D0 .. U+10F0, Georgian Mkhedruli
+		int c = 0x10D0 + i;
+		String s;
+		s.push_back(static_cast<Char>(0xE0 | (c >> 12)));
+		s.push_back(static_cast<Char>(0x80 | ((c >> 6) & 0x3F)));
+		s.push_back(static_cast<Char>(0x80 | (c & 0x3F)));
+		return s;
+	}
+
+	bool ends_with(const String& s, const String& e) {
+		return s.length() >= e.length() && s.compare(s.length() - e.length(), e.length(), e) == 0;
+	}
+
+	// Random stems, a third of them ending in ა and one in ე for the
+	// replacing affixes, and about half of their forms. absent gets words
+	// which aren't in the list.
+	String word_list(size_t stems, std::vector<String>& words, std::vector<String>& absent) {
+		std::mt19937 rng(42);
+		std::uniform_int_distribution<int> len(2, 7);
+		std::uniform_int_distribution<int> pick(0, 32);
+		std::bernoulli_distribution half(0.5);
+		std::set<String> unique;
+		for (size_t i = 0; i < stems; i++) {
+			String s;
+			for (int l = len(rng); l > 0; l--) {
+				s += letter(pick(rng));
+			}
+			absent.push_back(s + "ჱ"); // Not one of the letters above
+			switch (pick(rng) % 3) {
+				case 0: s += "ა"; break;
+				case 1: s += "ე"; break;
+			}
+			unique.insert(s);
+
+			if (ends_with(s, "ა") || ends_with(s, "ე")) {
+				String base = s.substr(0, s.length() - 3);
+				if (half(rng)) {
+					unique.insert(base + "ებს");
+				}
+				if (half(rng) && ends_with(s, "ა")) {
+					unique.insert(base + "ით");
+				}
+			}
+			if (half(rng)) {
+				unique.insert(s + "ის");
+			}
+			if (half(rng)) {
+				unique.insert("გა" + s);
+			}
+			if (half(rng)) {
+				unique.insert("მო" + s + "ს");
+			}
+		}
+		words.assign(unique.begin(), unique.end());
+		std::shuffle(words.begin(), words.end(), rng);
+
+		std::ostringstream out;
+		out << words.size() << "\n";
+		for (auto& w : words) {
+			out << w << "\n";
+		}
+		return out.str();
+	}
+
+	// The state of a run after loading.
+	struct Fixture {
+		WordList words;
+		Index index;
+		WordSet word_set;
+		WordList vstems;
+		Index vindex;
+		AffixGroupList groups;
+		SortedIndex sorted;
+		Stats stats;
+
+		Fixture(const String& list, WordSetType type = WordSetType::HASH)
+			: word_set(index), vstems(MemoryTag::VIRTUAL), vindex(MemoryTag::VIRTUAL) {
+			std::istringstream in(list);
+			WordListLoader(in, words, index).load();
+			std::istringstream aff(affix_file);
+			AffixParser(aff, groups).parse();
+			word_set.build(type);
+			sorted.build(word_set.all());
+		}
+	};
+
+	struct Result {
+		String name;
+		size_t ops;
+		double ns;
+		size_t bytes; // Input size, for throughput
+	};
+
+	std::vector<Result> results;
+
+	// Run setup and then the timed bench REPETITIONS times, keep the best.
+	template<class Setup, class Bench>
+	void measure(const String& name, size_t ops, size_t bytes, Setup setup, Bench bench) {
+		double best = 0;
+		for (int r = 0; r < REPETITIONS; r++) {
+			auto state = setup();
+			auto t0 = Clock::now();
+			bench(*state);
+			double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+			if (r == 0 || ns < best) {
+				best = ns;
+			}
+		}
+		results.push_back({name, ops, best, bytes});
+	}
+
+	// The premunched form of list, written by a normal run.
+	String premunched(const String& list) {
+		Options opt;
+		opt.no_compression = true;
+		Munch m(opt);
+		std::istringstream in(list), aff(affix_file);
+		m.load(in, aff, nullptr);
+		m.match();
+		std::ostringstream out;
+		m.write(out);
+		return out.str();
+	}
+
+	void print_json(std::ostream& out, size_t stems, size_t words) {
+		out << "{\n\t\"stems\": " << stems << ",\n\t\"words\": " << words
+			<< ",\n\t\"benchmarks\": [\n";
+		for (size_t i = 0; i < results.size(); i++) {
+			Result& r = results[i];
+			out << "\t\t{\"name\": \"" << r.name << "\", \"ops\": " << r.ops
+				<< ", \"ns_per_op\": " << r.ns / r.ops;
+			if (r.bytes != 0) {
+				out << ", \"mb_per_s\": " << r.bytes / (r.ns / 1e9) / (1024 * 1024);
+			}
+			out << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		out << "\t]\n}" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	size_t stems = argc > 1 ? std::stoul(argv[1]) : 20000;
+
+	std::vector<String> words, absent;
+	String list = word_list(stems, words, absent);
+	auto fixture = [&list] () { return std::unique_ptr<Fixture>(new Fixture(list)); };
+
+	// Affix::match of every word with the affix of one group, without
+	// confirming stems. The n-th group has the n-th shape.
+	for (size_t n = 0; n < 5; n++) {
+		AffixShape shape = AffixShape::GENERIC;
+		measure("affix_match/", words.size(), 0, fixture, [n, &shape] (Fixture& f) {
+				auto g = f.groups.begin();
+				std::advance(g, n);
+				MatchContext ctx(f.word_set, f.vstems, f.vindex, f.sorted, f.stats);
+				ctx.startGroup();
+				for (auto& a : g->getAffixes()) {
+					shape = a.getShape();
+					for (auto w : f.word_set.all()) {
+						a.match(ctx, *w);
+					}
+				}
+				ctx.flushProbes();
+			});
+		results.back().name += shape_names[static_cast<int>(shape)];
+	}
+
+	// Lookups of words in the list and of absent ones.
+	for (auto type : {WordSetType::HASH, WordSetType::DAWG}) {
+		String t = type == WordSetType::HASH ? "hash" : "dawg";
+		auto set = [&list, type] () { return std::unique_ptr<Fixture>(new Fixture(list, type)); };
+		size_t found = 0;
+		measure("lookup/" + t + "_hit", words.size(), 0, set, [&words, &found] (Fixture& f) {
+				for (auto& w : words) {
+					found += f.word_set.contains(w);
+				}
+			});
+		measure("lookup/" + t + "_miss", absent.size(), 0, set, [&absent, &found] (Fixture& f) {
+				for (auto& w : absent) {
+					found += f.word_set.contains(w);
+				}
+			});
+		if (found != words.size() * REPETITIONS) {
+			std::cerr << "ERROR: " << t << " lookups found " << found << " words." << std::endl;
+			return 1;
+		}
+	}
+
+	// Loading, with trimming and duplicate detection.
+	auto input = [&list] () { return std::unique_ptr<std::istringstream>(new std::istringstream(list)); };
+	measure("load_wordlist", words.size(), list.size(), input, [] (std::istringstream& in) {
+			WordList w;
+			Index i;
+			WordListLoader(in, w, i).load();
+		});
+
+	String pm = premunched(list);
+	struct PremunchedState {
+		std::istringstream in;
+		Fixture f;
+		PremunchedState(const String& pm, const String& list) : in(pm), f(list) {}
+	};
+	measure("load_premunched", words.size(), pm.size(),
+			[&pm, &list] () { return std::unique_ptr<PremunchedState>(new PremunchedState(pm, list)); },
+			[] (PremunchedState& s) {
+				PremunchedLoader(s.in, s.f.groups, s.f.words, s.f.index, s.f.vstems, s.f.vindex).load();
+			});
+
+	// Counting the matches of one stem after another, several times each.
+	const size_t counts = 4;
+	measure("count_match", words.size() * counts, 0, fixture, [] (Fixture& f) {
+			AffixGroup& g = f.groups.front();
+			Char score_id = g.getAffixes().front().getScoreId();
+			for (size_t c = 0; c < counts; c++) {
+				for (auto w : f.word_set.all()) {
+					g.countMatch(*w, 1, score_id);
+				}
+			}
+		});
+
+	// Formatting the output of a run, with the stems of all groups.
+	auto munched = [&pm, &list] () {
+			std::unique_ptr<PremunchedState> s(new PremunchedState(pm, list));
+			PremunchedLoader(s->in, s->f.groups, s->f.words, s->f.index, s->f.vstems, s->f.vindex).load();
+			return s;
+		};
+	measure("word_format", words.size(), 0, munched, [] (PremunchedState& s) {
+			std::vector<Word*> output;
+			collect_output(s.f.words, s.f.vstems, output);
+			std::ostringstream out;
+			for (auto w : output) {
+				w->format(out);
+			}
+		});
+
+	// Lookups in a query index of the result, mapped from a file.
+	char qi_file[] = "/tmp/xmunch-microbench-XXXXXX";
+	int fd = mkstemp(qi_file);
+	if (fd < 0) {
+		std::cerr << "ERROR: couldn't create a temporary file." << std::endl;
+		return 1;
+	}
+	close(fd);
+	{
+		Options opt;
+		opt.query_index = qi_file;
+		Munch m(opt);
+		std::istringstream in(list), aff(affix_file);
+		m.load(in, aff, nullptr);
+		m.match();
+		std::ostringstream out;
+		m.write(out);
+	}
+	auto mapped = [&qi_file] () {
+			std::unique_ptr<QueryIndex> qi(new QueryIndex());
+			qi->open(qi_file);
+			return qi;
+		};
+	size_t entries = 0;
+	measure("query_index/hit", words.size(), 0, mapped, [&words, &entries] (QueryIndex& qi) {
+			for (auto& w : words) {
+				QueryIndex::Range r = qi.find(w);
+				entries += r.second - r.first;
+			}
+		});
+	measure("query_index/miss", absent.size(), 0, mapped, [&absent, &entries] (QueryIndex& qi) {
+			for (auto& w : absent) {
+				QueryIndex::Range r = qi.find(w);
+				entries += r.second - r.first;
+			}
+		});
+	std::remove(qi_file);
+	if (entries < words.size() * REPETITIONS) {
+		std::cerr << "ERROR: query index lookups found " << entries << " entries." << std::endl;
+		return 1;
+	}
+
+	print_json(std::cout, stems, words.size());
+	return 0;
+}
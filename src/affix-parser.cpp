@@ -21,10 +21,11 @@
 
 #include <iostream>
 #include <cctype>
+#include <algorithm>
 
 using namespace xmunch;
 
-AffixParser::AffixParser(std::ifstream& s, AffixGroupList& a) : src(s), affixes(a) {}
+AffixParser::AffixParser(std::istream& s, AffixGroupList& a) : src(s), affixes(a) {}
 
 AffixParser::~AffixParser() {}
 
@@ -144,12 +145,12 @@ void AffixParser::readGroupFlags(AffixGroup& grp) {
 
 void AffixParser::readAffix(AffixGroup& grp) {
 
-	StringList beginnings = readEndings();
+	StringList beginnings = expandClasses(readEndings());
 	StringList endings;
 	if (src.peek() == ':') {
 		src.ignore();
 		skipWhite();
-		endings = readEndings();
+		endings = expandClasses(readEndings());
 	}
 
 	skipWhite();
@@ -209,21 +210,31 @@ void AffixParser::readAffix(AffixGroup& grp) {
 		}
 	}
 
-	if (suffix.front() == '.') {
+	if (!prefix.empty() && !suffix.empty()) {
+		handleAddCircumfix(
+				grp,
+				prefix,
+				suffix,
+				score,
+				score_id,
+				beginnings,
+				endings
+			);
+	} else if (suffix.front() == '.') {
+		// The endings are kept in the stem, only checked.
 		suffix.erase(0, 1);
-		bool autoscore = true;
-		for (auto& e : endings) {
+		if (!endings.empty()) {
 			handleAddPrefix(
 					grp,
 					prefix,
-					e + suffix,
+					suffix,
 					score,
 					score_id,
 					beginnings,
-					{e},
-					autoscore
+					{},
+					true,
+					endings
 				);
-			autoscore = false;
 		}
 	} else {
 		handleAddPrefix(
@@ -247,21 +258,23 @@ void AffixParser::handleAddPrefix(
 					Char score_id,
 					const std::list<String>& beginnings,
 					const std::list<String>& endings,
-					bool auto_score
+					bool auto_score,
+					const std::list<String>& scondition
 				) {
 	if (prefix.back() == '.') {
 		prefix.pop_back();
-		for (auto& b : beginnings) {
+		if (!beginnings.empty()) {
 			grp.addAffix(
-					prefix + b,
+					prefix,
 					suffix,
-					{b},
+					{},
 					endings,
 					score,
 					score_id,
-					auto_score
+					auto_score,
+					beginnings,
+					scondition
 					);
-			auto_score = false;
 		}
 	} else {
 		grp.addAffix(
@@ -271,10 +284,57 @@ void AffixParser::handleAddPrefix(
 				endings,
 				score,
 				score_id,
-				auto_score
+				auto_score,
+				{},
+				scondition
 				);
 	}
 }
+
+void AffixParser::handleAddCircumfix(
+					AffixGroup& grp,
+					String prefix,
+					String suffix,
+					int score,
+					Char score_id,
+					const std::list<String>& beginnings,
+					const std::list<String>& endings
+				) {
+	StringList preplace = beginnings;
+	StringList pcondition;
+	if (prefix.back() == '.') {
+		prefix.pop_back();
+		pcondition = beginnings;
+		preplace.clear();
+		if (pcondition.empty()) {
+			return;
+		}
+	}
+
+	StringList sreplace = endings;
+	StringList scondition;
+	if (suffix.front() == '.') {
+		suffix.erase(0, 1);
+		scondition = endings;
+		sreplace.clear();
+		if (scondition.empty()) {
+			return;
+		}
+	}
+
+	grp.addAffix(
+			prefix,
+			suffix,
+			preplace,
+			sreplace,
+			score,
+			score_id,
+			true,
+			pcondition,
+			scondition
+			);
+}
+
 String AffixParser::readAffixString() {
 	String a("");
 	while (src && !src.eof()) {
@@ -349,6 +409,37 @@ StringList AffixParser::readEndings() {
 	return endings;
 }
 
+StringList AffixParser::expandClasses(const StringList& endings) {
+	StringList expanded;
+	for (auto& e : endings) {
+		size_t open = e.find('[');
+		if (open == String::npos) {
+			expanded.push_back(e);
+			continue;
+		}
+		size_t close = e.find(']', open);
+		if (close == String::npos) {
+			std::cerr << "missing ']' in " << e << std::endl;
+			expanded.push_back(e);
+			continue;
+		}
+
+		StringList rest = expandClasses({e.substr(close + 1)});
+		size_t i = open + 1;
+		while (i < close) {
+			// One UTF-8 character.
+			unsigned char c = e[i];
+			size_t n = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+			n = std::min(n, close - i);
+			for (auto& r : rest) {
+				expanded.push_back(e.substr(0, open) + e.substr(i, n) + r);
+			}
+			i += n;
+		}
+	}
+	return expanded;
+}
+
 void xmunch::skip_over_whitespace(std::istream& src, bool nonl) {
 	std::string l;
 	int c;
@@ -21,11 +21,11 @@
 
 #include "xmunch.h"
 
-#include <fstream>
+#include <istream>
 
 namespace xmunch {
 	class AffixParser {
-		std::ifstream& src;
+		std::istream& src;
 
 		AffixGroupList& affixes;
 
@@ -33,7 +33,7 @@ namespace xmunch {
 
 		public:
 
-			AffixParser(std::ifstream& s, AffixGroupList& a);
+			AffixParser(std::istream& s, AffixGroupList& a);
 			~AffixParser();
 
 			void parse();
@@ -52,7 +52,20 @@ namespace xmunch {
 					Char score_id,
 					const std::list<String>& beginnings,
 					const std::list<String>& endings,
-					bool auto_score
+					bool auto_score,
+					const std::list<String>& scondition = std::list<String>()
+				);
+
+			// Add a circumfix as one affix. With '.', the beginnings
+			// (endings) become a condition of the prefix (suffix).
+			void handleAddCircumfix(
+					AffixGroup& grp,
+					String prefix,
+					String suffix,
+					int score,
+					Char score_id,
+					const std::list<String>& beginnings,
+					const std::list<String>& endings
 				);
 
 			String readAffixString();
@@ -63,6 +76,10 @@ namespace xmunch {
 
 			StringList readEndings();
 
+			// Replace endings with character classes ([aeiou]) by all the
+			// endings they stand for.
+			static StringList expandClasses(const StringList& endings);
+
 	};
 
 	void skip_over_whitespace(std::istream& s, bool no_newline = false);
@@ -18,6 +18,9 @@
 
 #include "affix.h"
 #include "word.h"
+#include "alphabet.h"
+#include "stem-resolver.h"
+#include "trace.h"
 
 #include <iostream>
 #include <algorithm>
@@ -29,6 +32,20 @@ using namespace xmunch;
 
 /* Setup */
 
+AffixPart::AffixPart(String t, StringList r, bool suffix, StringList cond) : text(Alphabet::encode(t)) {
+	for (auto& e : r) {
+		replace.push_back(Alphabet::encode(e));
+	}
+	if (replace.empty()) {
+		replace = {""};
+	}
+	for (auto& c : cond) {
+		c = Alphabet::encode(c);
+	}
+	condition.compile(cond, suffix);
+	kernel.compile(text, suffix);
+}
+
 Affix::Affix(
 		AffixGroup& grp,
 		String pref,
@@ -37,131 +54,489 @@ Affix::Affix(
 		StringList sreplace,
 		int sco,
 		Char scoid,
-		StemType st
-	) : group(grp), suffix(suff), prefix(pref), score(sco), score_id(scoid),
-		stem_type(st) {
-	if (preplace.empty()) {
-		stem_beginnings = {""};
-	} else {
-		stem_beginnings = preplace;
+		StemType st,
+		StringList pcond,
+		StringList scond
+	) : group(grp), score(sco), score_id(scoid), stem_type(st) {
+	addPrefix(pref, preplace, pcond);
+	addSuffix(suff, sreplace, scond);
+}
+
+void Affix::addPrefix(String pref, StringList preplace, StringList cond) {
+	prefixes.emplace_back(pref, preplace, false, cond);
+	classify();
+}
+
+void Affix::addSuffix(String suff, StringList sreplace, StringList cond) {
+	suffixes.emplace_back(suff, sreplace, true, cond);
+	classify();
+}
+
+void Affix::classify() {
+	conditional = false;
+	for (auto& p : prefixes) {
+		conditional = conditional || p.condition.isSet();
 	}
-	if (sreplace.empty()) {
-		stem_endings = {""};
-	} else {
-		stem_endings = sreplace;
+	for (auto& sp : suffixes) {
+		conditional = conditional || sp.condition.isSet();
 	}
-}
 
-void Affix::setStemEndings(StringList e) {
-	if (e.empty()) {
-		stem_endings = {""};
-	} else {
-		stem_endings = e;
+	shape = AffixShape::GENERIC;
+	if (prefixes.size() != 1 || suffixes.size() != 1 ||
+			prefixes.front().replace.size() != 1 || suffixes.front().replace.size() != 1) {
+		return;
+	}
+
+	const AffixPart& p = prefixes.front();
+	const AffixPart& sp = suffixes.front();
+	bool prefix = !p.text.empty() || !p.replace.front().empty();
+	bool suffix = !sp.text.empty() || !sp.replace.front().empty();
+
+	if (prefix && suffix) {
+		shape = AffixShape::CIRCUMFIX;
+	} else if (prefix) {
+		shape = AffixShape::PREFIX;
+	} else if (suffix) {
+		shape = sp.replace.front().empty() ? AffixShape::PLAIN_SUFFIX : AffixShape::SUFFIX;
 	}
 }
-void Affix::setStemBeginnings(StringList b) {
-	if (b.empty()) {
-		stem_beginnings = {""};
-	} else {
-		stem_beginnings = b;
+
+bool Affix::isCircumfix() const {
+	for (auto& p : prefixes) {
+		if (p.text.empty()) {
+			return false;
+		}
+	}
+	for (auto& p : suffixes) {
+		if (p.text.empty()) {
+			return false;
+		}
 	}
+	return true;
 }
 
 /* Core */
 
-void Affix::match(Index& words, WordList& vstems, Index& vindex, Word& w) {
-	if (!w.matchable()) {
-		return;
+bool AffixPart::matches(const Word& w, bool suffix) const {
+	if (text.empty()) {
+		return true;
 	}
 
 	const String& s = w.getWord();
-	auto begin = s.begin();
-	auto end = s.end();
+	if (kernel.isUsable()) {
+		return kernel.matches(w.getKey(), s.length());
+	}
 
-	if (!suffix.empty()) {
-		auto m = std::mismatch(
-				suffix.rbegin(),
-				suffix.rend(),
-				s.rbegin(),
-				s.rend()
-				);
-
-		if (m.first != suffix.rend()) { // No match
+	if (suffix) {
+		auto m = std::mismatch(text.rbegin(), text.rend(), s.rbegin(), s.rend());
+		return m.first == text.rend();
+	}
+	auto m = std::mismatch(text.begin(), text.end(), s.begin(), s.end());
+	return m.first == text.end();
+}
+
+bool Affix::fulfills(const AffixPart& p, const AffixPart& sp, const String& s, size_t begin, size_t end) {
+	size_t b = p.condition.match(s, begin, end);
+	if (b == StemCondition::NO_MATCH) {
+		return false;
+	}
+	size_t e = sp.condition.match(s, begin, end);
+	if (e == StemCondition::NO_MATCH) {
+		return false;
+	}
+	return end - begin > b + e;
+}
+
+void Affix::match(MatchContext& ctx, Word& w) {
+	switch (shape) {
+		case AffixShape::PLAIN_SUFFIX:
+			matchSingle<false, true, false>(ctx, w);
+			return;
+		case AffixShape::SUFFIX:
+			matchSingle<false, true, true>(ctx, w);
 			return;
+		case AffixShape::PREFIX:
+			matchSingle<true, false, true>(ctx, w);
+			return;
+		case AffixShape::CIRCUMFIX:
+			matchSingle<true, true, true>(ctx, w);
+			return;
+		case AffixShape::GENERIC:
+			break;
+	}
+
+	if (!w.matchable()) {
+		return;
+	}
+
+	for (auto& p : prefixes) {
+		if (p.matches(w, false)) {
+			matchWithPrefix(ctx, w, p);
 		}
+	}
+}
+
+void Affix::matchWithPrefix(MatchContext& ctx, Word& w, const AffixPart& p) {
+	if (shape == AffixShape::CIRCUMFIX) {
+		matchSingle<true, true, true, false>(ctx, w);
+		return;
+	}
 
-		end = m.second.base();
+	if (!w.matchable()) {
+		return;
 	}
 
-	if (!prefix.empty()) {
-		auto m = std::mismatch(
-				prefix.begin(),
-				prefix.end(),
-				s.begin(),
-				s.end()
-				);
-
-		if (m.first != prefix.end()) { // No match
-			return;
+	const String& s = w.getWord();
+	for (auto& sp : suffixes) {
+		if (!sp.matches(w, true)) {
+			continue;
 		}
 
-		begin = m.second;
+		if (s.length() <= p.text.length() + sp.text.length()) {
+			continue; // Empty match or overlap
+		}
+		if (conditional && !fulfills(p, sp, s, p.text.length(), s.length() - sp.text.length())) {
+			continue;
+		}
+
+		String stem(s, p.text.length(), s.length() - p.text.length() - sp.text.length());
+		for (auto& e : sp.replace) {
+			for (auto& b : p.replace) {
+				handleMatch(ctx, b + stem + e, w);
+			}
+		}
 	}
+}
 
-	if (begin >= end) { // Empty match or overlap
+template <bool prefix, bool suffix, bool replace, bool check_prefix>
+void Affix::matchSingle(MatchContext& ctx, Word& w) {
+	if (!w.matchable()) {
+		return;
+	}
+
+	const AffixPart& p = prefixes.front();
+	const AffixPart& sp = suffixes.front();
+	if (check_prefix && !p.matches(w, false)) {
+		return;
+	}
+	if (suffix && !sp.matches(w, true)) {
+		return;
+	}
+
+	const String& s = w.getWord();
+	size_t pl = prefix ? p.text.length() : 0;
+	size_t sl = suffix ? sp.text.length() : 0;
+	if (s.length() <= pl + sl) {
+		return; // Empty match or overlap
+	}
+	if (conditional && !fulfills(p, sp, s, pl, s.length() - sl)) {
+		return;
+	}
+
+	if (!replace) {
+		handleMatch(ctx, String(s, 0, s.length() - sl), w);
+		return;
+	}
+
+	const String& b = p.replace.front();
+	const String& e = sp.replace.front();
+	String stem;
+	stem.reserve(b.length() + s.length() - pl - sl + e.length());
+	stem.append(b).append(s, pl, s.length() - pl - sl).append(e);
+	handleMatch(ctx, stem, w);
+}
+
+namespace {
+	// StemCondition::match with plain string compares.
+	size_t shortest_alternative(const StemCondition& c, bool suffix, const String& s, size_t begin, size_t end) {
+		if (!c.isSet()) {
+			return 0;
+		}
+		size_t shortest = StemCondition::NO_MATCH;
+		for (auto& a : c.getAlternatives()) {
+			if (a.length() > end - begin || a.length() >= shortest) {
+				continue;
+			}
+			if (s.compare(suffix ? end - a.length() : begin, a.length(), a) == 0) {
+				shortest = a.length();
+			}
+		}
+		return shortest;
+	}
+}
+
+void Affix::matchReference(MatchContext& ctx, Word& w) {
+	if (!w.matchable()) {
 		return;
 	}
 
-	String stem(begin, end);
-	for (auto& e : stem_endings) {
-		for (auto& b : stem_beginnings) {
-			handleMatch(words, vstems, vindex, b + stem + e, w);
+	const String& s = w.getWord();
+	for (auto& p : prefixes) {
+		if (s.compare(0, p.text.length(), p.text) != 0) {
+			continue;
+		}
+		for (auto& sp : suffixes) {
+			if (s.length() <= p.text.length() + sp.text.length()) {
+				continue; // Empty match or overlap
+			}
+			if (s.compare(s.length() - sp.text.length(), sp.text.length(), sp.text) != 0) {
+				continue;
+			}
+			size_t begin = p.text.length();
+			size_t end = s.length() - sp.text.length();
+			size_t b = shortest_alternative(p.condition, false, s, begin, end);
+			size_t e = shortest_alternative(sp.condition, true, s, begin, end);
+			if (b == StemCondition::NO_MATCH || e == StemCondition::NO_MATCH || end - begin <= b + e) {
+				continue;
+			}
+
+			String stem(s, p.text.length(), s.length() - p.text.length() - sp.text.length());
+			for (auto& e : sp.replace) {
+				for (auto& b : p.replace) {
+					handleMatch(ctx, b + stem + e, w);
+				}
+			}
+		}
+	}
+}
+
+SortedIndex::Range Affix::candidates(const SortedIndex& sorted) const {
+	if (prefixes.size() != 1 || suffixes.size() != 1) {
+		return sorted.all();
+	}
+
+	const String& suffix = suffixes.front().text;
+	const String& prefix = prefixes.front().text;
+
+	SortedIndex::Range r = sorted.all();
+	if (!suffix.empty()) {
+		r = sorted.withSuffix(suffix);
+	}
+	if (!prefix.empty()) {
+		SortedIndex::Range p = sorted.withPrefix(prefix);
+		if (p.second - p.first < r.second - r.first) {
+			r = p;
 		}
 	}
+	return r;
+}
+
+void Affix::handleMatch(MatchContext& ctx, const String& stem, Word& w) {
+	if (ctx.batchesProbes()) {
+		ctx.queueProbe(*this, stem, w);
+		return;
+	}
+	handleLookup(ctx, stem, ctx.find(stem), w);
 }
 
-void Affix::handleMatch(
-				Index& words,
-				WordList& vstems,
-				Index& vindex,
-				const String& stem,
-				Word& w
-) {
+void Affix::handleLookup(MatchContext& ctx, const String& stem, StemLookup l, Word& w) {
 	Word * s;
-	if (words.count(stem) == 1) {
-		if (stem_type == StemType::VIRTUAL) {
+	if (l.kind == StemLookup::NORMAL) {
+		if (stem_type == StemType::VIRTUAL && !ctx.isPartial(*l.word)) {
 			// We are not allowed to "virtualize" this word -> no match.
 			return;
 		}
-		s = &words.at(stem);
+		s = l.word;
 	} else if (stem_type != StemType::NORMAL) {
-		if (vindex.count(stem) == 0) {
-			vstems.emplace_back(stem);
-			vindex.emplace(stem, vstems.back());
-			vstems.back().setStemType(StemType::UNDEFINED);
+		if (l.kind == StemLookup::VIRTUAL) {
+			s = l.word;
+		} else {
+			s = ctx.addVirtual(stem);
+			if (s == nullptr) {
+				return;
+			}
 		}
-		s = &vindex.at(stem);
 	} else {
 		return;
 	}
-	s->addAffix(group, *this, w);
-	group.countMatch(*s, score, score_id);
+	group.addMatch(ctx, *s, *this, w);
+}
+
+namespace {
+	// Size of the smallest range of sorted with words starting with prefix
+	// and ending with suffix.
+	size_t range_size(const SortedIndex& sorted, const String& prefix, const String& suffix) {
+		size_t n = sorted.size();
+		if (!suffix.empty()) {
+			SortedIndex::Range r = sorted.withSuffix(suffix);
+			n = std::min<size_t>(n, r.second - r.first);
+		}
+		if (!prefix.empty()) {
+			SortedIndex::Range r = sorted.withPrefix(prefix);
+			n = std::min<size_t>(n, r.second - r.first);
+		}
+		return n;
+	}
+
+	// A lookup in relation to checking a word or visiting a range entry.
+	const size_t PROBE_COST = 4;
+}
+
+namespace {
+	// What the stems matched by a part begin or end with besides its
+	// replacements: the alternatives of its condition. Stems always have
+	// exactly one of the minimal ones.
+	StringList condition_keys(const AffixPart& p) {
+		return p.condition.isSet() ? p.condition.getMinimalAlternatives() : StringList{""};
+	}
+
+	bool has_prefix(const String& s, const String& p) {
+		return s.length() >= p.length() && s.compare(0, p.length(), p) == 0;
+	}
+
+	bool has_suffix(const String& s, const String& e) {
+		return s.length() >= e.length() && s.compare(s.length() - e.length(), e.length(), e) == 0;
+	}
+}
+
+void Affix::estimateCosts(const SortedIndex& sorted, MatchCosts& costs) const {
+	for (auto& p : prefixes) {
+		for (auto& sp : suffixes) {
+			size_t matching = range_size(sorted, p.text, sp.text);
+			costs.strip_visits += matching;
+			costs.strip_probes += matching * p.replace.size() * sp.replace.size();
+			for (auto& e : sp.replace) {
+				for (auto& b : p.replace) {
+					for (auto& pk : condition_keys(p)) {
+						for (auto& sk : condition_keys(sp)) {
+							costs.forward_visits += range_size(sorted, b + pk, sk + e);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void Affix::matchForward(MatchContext& ctx) {
+	for (auto& p : prefixes) {
+		for (auto& sp : suffixes) {
+			StringList pkeys = condition_keys(p);
+			StringList skeys = condition_keys(sp);
+			for (auto& e : sp.replace) {
+				for (auto& b : p.replace) {
+					for (auto& pk : pkeys) {
+						for (auto& sk : skeys) {
+							matchForward(ctx, p, sp, b + pk, sk + e);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void Affix::matchForward(MatchContext& ctx, const AffixPart& p, const AffixPart& sp, const String& begin, const String& end) {
+	// For a condition, begin and end contain the alternative, which
+	// stays in the stem. Replacements are empty then.
+	const String& b = p.condition.isSet() ? p.replace.front() : begin;
+	const String& e = sp.condition.isSet() ? sp.replace.front() : end;
+
+	SortedIndex::Range r = ctx.sorted.all();
+	if (!end.empty()) {
+		r = ctx.sorted.withSuffix(end);
+	}
+	if (!begin.empty()) {
+		SortedIndex::Range pr = ctx.sorted.withPrefix(begin);
+		if (pr.second - pr.first < r.second - r.first) {
+			r = pr;
+		}
+	}
+
+	String form;
+	for (auto i = r.first; i != r.second; ++i) {
+		Word& s = **i;
+		const String& st = s.getWord();
+		if (st.length() <= b.length() + e.length()) {
+			continue; // Same as the empty match check in match.
+		}
+		if (!has_prefix(st, begin) || !has_suffix(st, end)) {
+			continue;
+		}
+		if (conditional && !fulfills(p, sp, st, b.length(), st.length() - e.length())) {
+			continue;
+		}
+
+		form.assign(p.text)
+			.append(st, b.length(), st.length() - b.length() - e.length())
+			.append(sp.text);
+		ctx.stats.forward_probes++;
+		Word* f = ctx.words.find(form);
+		if (f == nullptr || !f->matchable()) {
+			continue;
+		}
+
+		// What handleMatch does for a stem in the word list.
+		group.addMatch(ctx, s, *this, *f);
+	}
+}
+
+void Affix::generate(const String& stem, StringList& forms) const {
+	for (auto& p : prefixes) {
+		for (auto& sp : suffixes) {
+			for (auto& e : sp.replace) {
+				for (auto& b : p.replace) {
+					if (stem.length() <= b.length() + e.length()) {
+						continue; // Same as the empty match check in match.
+					}
+					if (!has_prefix(stem, b) || !has_suffix(stem, e)) {
+						continue;
+					}
+					if (conditional && !fulfills(p, sp, stem, b.length(), stem.length() - e.length())) {
+						continue;
+					}
+					forms.push_back(
+							p.text +
+							stem.substr(b.length(), stem.length() - b.length() - e.length()) +
+							sp.text
+						);
+				}
+			}
+		}
+	}
 }
 
 
 /* Extra */
 
 void Affix::print() {
-	std::cerr << "AFF " << prefix << ":" << suffix
-		<< " (" << score_id << score << ") [";
-	for (auto& b : stem_beginnings) {
-		std::cerr << b << ',';
+	bool first = true;
+	for (auto& p : prefixes) {
+		for (auto& sp : suffixes) {
+			std::cerr << (first ? "" : " ") << "AFF " << Alphabet::decode(p.text)
+				<< ":" << Alphabet::decode(sp.text);
+			first = false;
+		}
+	}
+	std::cerr << " (" << score_id << score << ") [";
+	for (auto& p : prefixes) {
+		for (auto& b : p.replace) {
+			std::cerr << Alphabet::decode(b) << ',';
+		}
 	}
 	std::cerr << ":";
-	for (auto& e : stem_endings) {
-		std::cerr << e << ',';
+	for (auto& sp : suffixes) {
+		for (auto& e : sp.replace) {
+			std::cerr << Alphabet::decode(e) << ',';
+		}
+	}
+	std::cerr << "]";
+	if (conditional) {
+		std::cerr << " if [";
+		for (auto& p : prefixes) {
+			for (auto& b : p.condition.getAlternatives()) {
+				std::cerr << Alphabet::decode(b) << ',';
+			}
+		}
+		std::cerr << ":";
+		for (auto& sp : suffixes) {
+			for (auto& e : sp.condition.getAlternatives()) {
+				std::cerr << Alphabet::decode(e) << ',';
+			}
+		}
+		std::cerr << "]";
 	}
-	std::cerr << "] " << static_cast<char>(stem_type) << std::endl;
+	std::cerr << " " << static_cast<char>(stem_type) << std::endl;
 }
 
 
@@ -171,7 +546,7 @@ void Affix::print() {
 /* Setup */
 
 AffixGroup::AffixGroup(int i, String n)
-	: id(i), name(n), auto_score(true), stem_type(StemType::NORMAL) {
+	: id(i), name(n), auto_score(true), stem_type(StemType::NORMAL), scratch(nullptr) {
 		min_affix_score['*'] = 0;
 }
 
@@ -196,14 +571,16 @@ void AffixGroup::addMinScore(int s, Char n) {
 	min_affix_score[n] = s;
 }
 
-void AffixGroup::addAffix(
+Affix& AffixGroup::addAffix(
 					String prefix,
 					String suffix,
 					StringList preplace,
 					StringList sreplace,
 					int score,
 					Char score_id,
-					bool as
+					bool as,
+					StringList pcondition,
+					StringList scondition
 	) {
 	affixes.emplace_back(
 			*this,
@@ -213,7 +590,9 @@ void AffixGroup::addAffix(
 			sreplace,
 			score,
 			score_id,
-			stem_type
+			stem_type,
+			pcondition,
+			scondition
 		);
 	if (min_affix_score.count(score_id) == 0) {
 		std::cerr << "Affix error: group: " << name <<
@@ -223,82 +602,263 @@ void AffixGroup::addAffix(
 	if (auto_score && as) {
 		min_affix_score[score_id] += score;
 	}
+	return affixes.back();
 }
 
 
 /* Core */
-void AffixGroup::match(Index& words, WordList& vstems, Index& vindex) {
-	for (auto& w : words) {
-		for (auto& a : affixes) {
-			a.match(words, vstems, vindex, w.second);
+void AffixGroup::collect(MatchContext& ctx) {
+	Trace::Span span("collect", name);
+	ctx.startGroup();
+
+	if (ctx.getEngine() == Engine::REFERENCE) {
+		for (auto w : ctx.words.all()) {
+			for (auto& a : affixes) {
+				a.matchReference(ctx, *w);
+			}
 		}
+	} else {
+		matchAffixes(ctx);
 	}
+}
+
+void AffixGroup::addMatch(MatchContext& ctx, Word& stem, const Affix& a, Word& w) {
+	if (ctx.resolver != nullptr) {
+		ctx.resolver->addEdge(*this, stem, a, w);
+		return;
+	}
+	stem.addAffix(*this, a, w);
+	countMatch(stem, a.getScore(), a.getScoreId());
+}
+
+void AffixGroup::match(MatchContext& ctx) {
+	Trace::Span span("group", name);
+	scratch = &ctx.scratch;
+	match_scores = ScoreTable(ScoreTable::allocator_type(MemoryTag::SCORES, scratch));
+
+	collect(ctx);
 
 	// To handle interlinked stems (a is stem of b is stem of c), we sort by
 	// negative total score and stem length. This allows us prioritize correctly and
-	// skip used words with hasStem later.
-	std::set<std::tuple<int, int, Word*, std::map<Char, int>* > > sorted_scores;
-	for (auto& m : match_scores) {
-		if (!isMatchingStemType(m.first->getStemType())) {
-			continue;
+	// skip used words with hasStem later. Of equally good stems, words of the
+	// word list come first, in the order they were read, then those only in
+	// the premunched data; virtual ones are ordered by the stem itself, so
+	// the result doesn't depend on addresses or the matching order.
+	typedef std::tuple<int, int, bool, Word*, ScoreMap*> ScoreEntry;
+	auto order = [] (const ScoreEntry& a, const ScoreEntry& b) {
+		if (std::get<0>(a) != std::get<0>(b)) {
+			return std::get<0>(a) < std::get<0>(b);
+		}
+		if (std::get<1>(a) != std::get<1>(b)) {
+			return std::get<1>(a) < std::get<1>(b);
 		}
+		if (std::get<2>(a) != std::get<2>(b)) {
+			return std::get<2>(b);
+		}
+		if (!std::get<2>(a) && std::get<3>(a)->getId() != std::get<3>(b)->getId()) {
+			return std::get<3>(a)->getId() < std::get<3>(b)->getId();
+		}
+		// Distinct words must never compare equal, the set would drop one.
+		return std::get<3>(a)->getWord() < std::get<3>(b)->getWord();
+	};
+	std::set<ScoreEntry, decltype(order), TaggedAllocator<ScoreEntry, MemoryTag::SCORES> > sorted_scores(
+			order,
+			TaggedAllocator<ScoreEntry, MemoryTag::SCORES>(MemoryTag::SCORES, scratch)
+		);
+	{
+		Trace::Span span("rank stems");
+		for (auto& m : match_scores) {
+			if (!isMatchingStemType(m.first->getStemType())) {
+				continue;
+			}
 
-		// Check if the stem is already confirmed as valid (by premunched data).
-		// In that case just confirm all matches.
-		if (m.first->isStemOf(*this)) {
-			confirmStem(*m.first);
-			continue;
+			// Check if the stem is already confirmed as valid (by premunched data).
+			// In that case just confirm all matches.
+			if (m.first->isStemOf(*this)) {
+				confirmStem(*m.first);
+				continue;
+			}
+
+			bool valid = true;
+			int tot_score = 0;
+			for (auto& s : m.second) {
+				if (min_affix_score.at(s.first) > s.second) {
+					valid = false;
+					break;
+				}
+				tot_score += s.second;
+			}
+
+			if (valid) {
+				sorted_scores.emplace(
+						-tot_score,
+						m.first->getWord().length(),
+						!ctx.words.contains(m.first->getWord()),
+						m.first,
+						&m.second
+					);
+			}
 		}
+	}
+
+	{
+		Trace::Span span("confirm stems");
+		for (auto& m : sorted_scores) {
+			Word* w = std::get<3>(m);
 
-		bool valid = true;
-		int tot_score = 0;
-		for (auto& s : m.second) {
-			if (min_affix_score.at(s.first) > s.second) {
-				valid = false;
-				break;
+			if (w->hasStem()) {
+				continue;
+			}
+
+			// Recheck validity if a derived word is a stem on its own now.
+			bool valid = true;
+			for (auto& c : w->getAffixesByGroup(*this)) {
+				if (c.word.isStem()) {
+					Char cn = c.affix.getScoreId();
+					int score = std::get<4>(m)->at(cn) - c.affix.getScore();
+					if (min_affix_score.at(cn) > score) {
+						valid = false;
+						break;
+					}
+				}
+			}
+
+			if (valid) {
+				confirmStem(*w);
 			}
-			tot_score += s.second;
 		}
+	}
 
-		if (valid) {
-			sorted_scores.emplace(-tot_score, m.first->getWord().length(), m.first, &m.second);
+	// Copy the affix lists of confirmed stems out of the arena, the other
+	// ones, the scores and unconfirmed candidates are not needed anymore.
+	sorted_scores.clear();
+	{
+		Trace::Span span("settle affix lists");
+		for (auto& m : match_scores) {
+			m.first->settleAffixes(*this, m.first->isStemOf(*this));
 		}
 	}
+	match_scores = ScoreTable();
+	scratch = nullptr;
+	ctx.finishGroup();
+}
 
-	for (auto& m : sorted_scores) {
-		Word* w = std::get<2>(m);
+void AffixGroup::generate(const String& stem, StringList& forms) const {
+	for (auto& a : affixes) {
+		a.generate(stem, forms);
+	}
+}
 
-		if (w->hasStem()) {
-			continue;
+void AffixGroup::matchAffixes(MatchContext& ctx) {
+	if (selectForward(ctx.sorted)) {
+		Trace::Span span("generate forms");
+		ctx.stats.forward_groups++;
+		for (auto& a : affixes) {
+			a.matchForward(ctx);
 		}
+		return;
+	}
 
-		// Recheck validity if a derived word is a stem on its own now.
-		bool valid = true;
-		for (auto& c : w->getAffixesByGroup(*this)) {
-			if (c.word.isStem()) {
-				Char cn = c.affix.getScoreId();
-				int score = std::get<3>(m)->at(cn) - c.affix.getScore();
-				if (min_affix_score.at(cn) > score) {
-					valid = false;
-					break;
-				}
+	{
+		Trace::Span span("match circumfixes");
+		matchCircumfixes(ctx);
+	}
+
+	Trace::Span span("match affixes");
+	std::vector<Affix*> affs;
+	for (auto& a : affixes) {
+		if (!a.isCircumfix()) {
+			affs.push_back(&a);
+		}
+	}
+
+	std::vector<SortedIndex::Range> ranges;
+	if (selectAffixRanges(ctx.sorted, affs, ranges)) {
+		auto r = ranges.begin();
+		for (auto a : affs) {
+			for (auto i = r->first; i != r->second; ++i) {
+				a->match(ctx, **i);
 			}
+			++r;
+		}
+	} else if (!affs.empty()) {
+		for (auto w : ctx.words.all()) {
+			for (auto a : affs) {
+				a->match(ctx, *w);
+			}
+		}
+	}
+	ctx.flushProbes();
+}
+
+bool AffixGroup::selectForward(const SortedIndex& sorted) {
+	if (stem_type != StemType::NORMAL) {
+		return false; // Stems which aren't words can't be enumerated.
+	}
+
+	MatchCosts c;
+	for (auto& a : affixes) {
+		a.estimateCosts(sorted, c);
+	}
+
+	// Visiting a range entry costs about twice as much as testing a word,
+	// but stripping never tests more than every word with every affix. All
+	// forms generated forward are looked up.
+	size_t strip = std::min(2 * c.strip_visits, sorted.size() * affixes.size()) +
+		PROBE_COST * c.strip_probes;
+	size_t forward = (2 + PROBE_COST) * c.forward_visits;
+	return forward < strip;
+}
+
+bool AffixGroup::selectAffixRanges(
+		const SortedIndex& sorted,
+		const std::vector<Affix*>& affs,
+		std::vector<SortedIndex::Range>& ranges
+	) {
+	size_t total = 0;
+	for (auto a : affs) {
+		ranges.push_back(a->candidates(sorted));
+		total += ranges.back().second - ranges.back().first;
+	}
+	// Visiting a range entry costs about twice as much as testing a word
+	// in the word by word loop, because of the indirection and the
+	// per-affix passes.
+	return total * 2 < sorted.size() * affs.size();
+}
+
+void AffixGroup::matchCircumfixes(MatchContext& ctx) {
+	// Group all circumfix prefixes, so every prefix range is only searched
+	// and walked once.
+	std::map<String, std::list<std::pair<Affix*, const AffixPart*> > > by_prefix;
+	for (auto& a : affixes) {
+		if (!a.isCircumfix()) {
+			continue;
 		}
+		for (auto& p : a.getPrefixes()) {
+			by_prefix[p.text].emplace_back(&a, &p);
+		}
+	}
 
-		if (valid) {
-			confirmStem(*w);
+	for (auto& b : by_prefix) {
+		SortedIndex::Range r = ctx.sorted.withPrefix(b.first);
+		for (auto i = r.first; i != r.second; ++i) {
+			for (auto& ap : b.second) {
+				ap.first->matchWithPrefix(ctx, **i, *ap.second);
+			}
 		}
 	}
+	ctx.flushProbes();
 }
 
 void AffixGroup::countMatch(Word& stem, int score, Char score_id) {
-	if (match_scores.count(&stem) == 0) {
-		auto& ms = match_scores[&stem];
+	auto m = match_scores.find(&stem);
+	if (m == match_scores.end()) {
+		m = match_scores.emplace(&stem, ScoreMap(ScoreMap::allocator_type(MemoryTag::SCORES, scratch))).first;
 		for (auto& a : min_affix_score) {
-			ms.emplace(a.first, 0);
+			m->second.emplace(a.first, 0);
 		}
 	}
-	match_scores.at(&stem).at(score_id) += score;
+	m->second.at(score_id) += score;
 }
 
 void AffixGroup::confirmStem(Word& stem) {
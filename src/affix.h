@@ -20,8 +20,13 @@
 #define _XMUNCH_AFFIX_H_ 
 
 #include "xmunch.h"
+#include "match-kernel.h"
+#include "sorted-index.h"
+#include "match-context.h"
+#include "stem-condition.h"
 
 #include <list>
+#include <vector>
 
 namespace xmunch {
 
@@ -33,19 +38,56 @@ namespace xmunch {
 		UNDEFINED = 'u' // Only to be used in word objects
 	};
 
+	/**
+	 * One prefix or suffix alternative of an affix, with the stem beginnings
+	 * or endings which replace it, or the ones the stem must have next to
+	 * it (condition, for . affixes).
+	 */
+	struct AffixPart {
+		String text;
+		StringList replace;
+		AffixKernel kernel;
+		StemCondition condition;
+
+		AffixPart(String t, StringList r, bool suffix, StringList cond = StringList());
+
+		bool matches(const Word& w, bool suffix) const;
+	};
+
+	// How an affix is matched, decided when it is built. All but GENERIC
+	// have exactly one prefix and one suffix part with one replacement each.
+	enum class AffixShape : char {
+		PLAIN_SUFFIX, // Suffix only, the stem is the rest of the word
+		SUFFIX, // Suffix only, replaced by a stem ending
+		PREFIX, // Prefix only
+		CIRCUMFIX, // Prefix and suffix
+		GENERIC // Several alternatives
+	};
+
+	// Estimated work of the matching strategies, in words or range entries
+	// visited and index lookups.
+	struct MatchCosts {
+		size_t strip_visits = 0;
+		size_t strip_probes = 0;
+		size_t forward_visits = 0; // Every visit is a lookup
+	};
+
 	class Affix {
 		AffixGroup& group;	
 
-		String suffix;
-		String prefix;
+		// Usually there is one prefix and one suffix (which might be
+		// empty). Circumfixes using . get one part per alternative instead
+		// of one Affix per combination.
+		std::vector<AffixPart> prefixes;
+		std::vector<AffixPart> suffixes;
 
 		int score;
 		Char score_id;
 
 		StemType stem_type;
 
-		StringList stem_beginnings;
-		StringList stem_endings;
+		AffixShape shape;
+		bool conditional; // A part has a condition
 
 		public:
 			Affix(
@@ -56,27 +98,73 @@ namespace xmunch {
 					StringList sreplace,
 					int sco,
 					Char scoid,
-					StemType stype
+					StemType stype,
+					StringList pcond = StringList(),
+					StringList scond = StringList()
 				);
 
-			void setStemEndings(StringList e);
-			void setStemBeginnings(StringList b);
+			void addPrefix(String pref, StringList preplace, StringList cond = StringList());
+			void addSuffix(String suff, StringList sreplace, StringList cond = StringList());
+
+			const std::vector<AffixPart>& getPrefixes() const { return prefixes; }
+			const std::vector<AffixPart>& getSuffixes() const { return suffixes; }
+			bool isCircumfix() const;
+			AffixShape getShape() const { return shape; }
 
 			Char getScoreId() const { return score_id; }
 			int getScore() const { return score; }
+			StemType getStemType() const { return stem_type; }
 
-			void match(Index& words, WordList& vstems, Index& vindex, Word& word);
+			void match(MatchContext& ctx, Word& word);
+
+			// Like match, but prefix is known to match word already.
+			void matchWithPrefix(MatchContext& ctx, Word& word, const AffixPart& prefix);
+
+			// Like match, with plain string compares instead of the
+			// kernels (used by the reference engine).
+			void matchReference(MatchContext& ctx, Word& word);
+
+			// The smallest range of sorted containing all words this affix
+			// might match.
+			SortedIndex::Range candidates(const SortedIndex& sorted) const;
+
+			// Match by generating the forms of all words of sorted, which
+			// fulfill the stem conditions, and looking them up. Only for
+			// groups which don't create virtual stems.
+			void matchForward(MatchContext& ctx);
+
+			// Add the estimated work of match over all words and of
+			// matchForward to costs.
+			void estimateCosts(const SortedIndex& sorted, MatchCosts& costs) const;
+
+			// Reverse of match: add the words derived from stem to forms.
+			void generate(const String& stem, StringList& forms) const;
 
 			void print();
 
+			// The rest of handleMatch, once stem was looked up.
+			void handleLookup(MatchContext& ctx, const String& stem, StemLookup l, Word& w);
+
 		protected: 
-			void handleMatch(
-					Index& words,
-					WordList& vstems,
-					Index& vindex,
-					const String& stem,
-					Word& w
-					);
+			// Look stem up, or queue it with the optimized engine.
+			void handleMatch(MatchContext& ctx, const String& stem, Word& w);
+
+			void classify();
+
+			// Whether s[begin, end), what is left of a word or stem
+			// between p and sp, fulfills their conditions and keeps a
+			// non-empty part between them.
+			static bool fulfills(const AffixPart& p, const AffixPart& sp, const String& s, size_t begin, size_t end);
+
+			// matchForward for the stems beginning with begin and ending
+			// with end, replacements or condition alternatives of p and sp.
+			void matchForward(MatchContext& ctx, const AffixPart& p, const AffixPart& sp, const String& begin, const String& end);
+
+			// Match an affix with a single alternative, without loops over
+			// parts and replacements. check_prefix is false if the prefix
+			// is known to match already.
+			template <bool prefix, bool suffix, bool replace, bool check_prefix = prefix>
+			void matchSingle(MatchContext& ctx, Word& w);
 	};
 
 	class AffixGroup {
@@ -91,7 +179,22 @@ namespace xmunch {
 		
 		std::list<Affix> affixes;
 
-		std::map<Word*, std::map<Char, int> > match_scores;
+		typedef std::map<
+				Char,
+				int,
+				std::less<Char>,
+				TaggedAllocator<std::pair<const Char, int>, MemoryTag::SCORES>
+			> ScoreMap;
+		typedef std::map<
+				Word*,
+				ScoreMap,
+				std::less<Word*>,
+				TaggedAllocator<std::pair<Word* const, ScoreMap>, MemoryTag::SCORES>
+			> ScoreTable;
+		ScoreTable match_scores;
+
+		// While matching, scores and new affix lists are allocated here.
+		Arena* scratch;
 
 		static String stem_separator;
 		static String name_separator;
@@ -101,14 +204,16 @@ namespace xmunch {
 
 			AffixGroup(int i, String n);
 
-			void addAffix(
+			Affix& addAffix(
 					String prefix,
 					String suffix,
 					StringList preplace,
 					StringList sreplace,
 					int score,
 					Char score_id,
-					bool autoscore = true // Allow auto score.
+					bool autoscore = true, // Allow auto score.
+					StringList pcondition = StringList(),
+					StringList scondition = StringList()
 					);
 			void setStemType(StemType t);
 			void addMinScore(int s, Char n);
@@ -119,20 +224,64 @@ namespace xmunch {
 					const String& vm
 					);
 
+			int getId() const { return id; }
 			const String& getName() const { return name; };
 			StemType getStemType()  const { return stem_type; }
+			const std::map<Char, int>& getMinScores() const { return min_affix_score; }
+			std::list<Affix>& getAffixes() { return affixes; }
 			static const String& getStemSep()  { return stem_separator; };
 			static const String& getAffSep()   { return name_separator; };
 			static const String& getVirtMark() { return virtual_marker; };
 
-			void match(Index& words, WordList& vstems, Index& vindex);
+			// Match and confirm the stems of this group.
+			void match(MatchContext& ctx);
+
+			// Only match, for the StemResolver of the context.
+			void collect(MatchContext& ctx);
+
+			// Record that affix a derives w from stem.
+			void addMatch(MatchContext& ctx, Word& stem, const Affix& a, Word& w);
+
+			void generate(const String& stem, StringList& forms) const;
 			void countMatch(Word& stem, int score, Char score_id);
 			void confirmStem(Word& stem);
 
+			// Allocator for the affix lists of new stems.
+			AffixedWordList::allocator_type getListAllocator() const {
+				return AffixedWordList::allocator_type(MemoryTag::AFFIXES, scratch);
+			}
+
 			bool isMatchingStemType(StemType tword);
 			StemType getNewStemType(StemType told);
 
 			void print();
+
+		protected:
+
+			// Run the optimized matching strategies over all words.
+			void matchAffixes(MatchContext& ctx);
+
+			// Decide if generating the forms of the stems is cheaper than
+			// stripping the affixes from the words.
+			bool selectForward(const SortedIndex& sorted);
+
+			// Decide if matching should run affix by affix over the
+			// candidate ranges of sorted instead of word by word.
+			bool selectAffixRanges(
+					const SortedIndex& sorted,
+					const std::vector<Affix*>& affs,
+					std::vector<SortedIndex::Range>& ranges
+					);
+
+			// Match circumfixes over the words with their prefixes only.
+			void matchCircumfixes(MatchContext& ctx);
+	};
+
+	// Orders groups as defined in the affix file.
+	struct AffixGroupOrder {
+		bool operator()(const AffixGroup* a, const AffixGroup* b) const {
+			return a->getId() < b->getId();
+		}
 	};
 }
 
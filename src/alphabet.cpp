@@ -0,0 +1,102 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "alphabet.h"
+
+#include <iostream>
+#include <cstdlib>
+
+using namespace xmunch;
+
+bool Alphabet::enabled = false;
+std::unordered_map<uint32_t, Char> Alphabet::codes;
+// Code 0 is never used, so encoded strings don't contain null bytes.
+std::vector<String> Alphabet::symbols(1);
+
+Char Alphabet::code(uint32_t cp, const String& bytes) {
+	auto i = codes.find(cp);
+	if (i != codes.end()) {
+		return i->second;
+	}
+
+	if (symbols.size() > 255) {
+		std::cerr << "Error, the input uses more than 255 different characters, "
+			<< "it can't be used with --remap-alphabet." << std::endl;
+		std::exit(1);
+	}
+
+	Char c = static_cast<Char>(symbols.size());
+	codes.emplace(cp, c);
+	symbols.push_back(bytes);
+	return c;
+}
+
+String Alphabet::encode(const String& s) {
+	if (!enabled) {
+		return s;
+	}
+
+	String r;
+	r.reserve(s.length());
+	size_t i = 0;
+	while (i < s.length()) {
+		unsigned char c = s[i];
+		size_t len = 1;
+		uint32_t cp = c;
+		if (c >= 0xF0) {
+			len = 4;
+			cp = c & 0x07;
+		} else if (c >= 0xE0) {
+			len = 3;
+			cp = c & 0x0F;
+		} else if (c >= 0xC0) {
+			len = 2;
+			cp = c & 0x1F;
+		}
+
+		bool valid = i + len <= s.length();
+		for (size_t j = 1; valid && j < len; j++) {
+			unsigned char n = s[i + j];
+			valid = (n & 0xC0) == 0x80;
+			cp = (cp << 6) | (n & 0x3F);
+		}
+		if (!valid) {
+			// Keep invalid bytes as they are, each as its own character
+			// outside the unicode range.
+			len = 1;
+			cp = 0x110000 + c;
+		}
+
+		r.push_back(code(cp, s.substr(i, len)));
+		i += len;
+	}
+	return r;
+}
+
+String Alphabet::decode(const String& s) {
+	if (!enabled) {
+		return s;
+	}
+
+	String r;
+	r.reserve(s.length() * 3);
+	for (unsigned char c : s) {
+		r += symbols[c];
+	}
+	return r;
+}
@@ -0,0 +1,58 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_ALPHABET_H_
+#define _XMUNCH_ALPHABET_H_
+
+#include "xmunch.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace xmunch {
+
+	/**
+	 * Optional remapping of the UTF-8 input to one byte per character. Every
+	 * character seen gets the next free code, so for small alphabets words
+	 * shrink to a third (Georgian) and most of them fit into the 16 bytes
+	 * used by WordKey and WordHash. Words and affixes are encoded when read
+	 * and decoded when written; group names and markers are left alone.
+	 */
+	class Alphabet {
+		static bool enabled;
+
+		static std::unordered_map<uint32_t, Char> codes;
+		static std::vector<String> symbols;
+
+		public:
+			static void enable() { enabled = true; }
+			static bool isEnabled() { return enabled; }
+
+			// Both return s unchanged if remapping is not enabled.
+			static String encode(const String& s);
+			static String decode(const String& s);
+
+			static size_t size() { return symbols.size() - 1; }
+
+		protected:
+
+			static Char code(uint32_t cp, const String& bytes);
+	};
+}
+
+#endif /* ifndef _XMUNCH_ALPHABET_H_ */
@@ -0,0 +1,67 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "bloom-filter.h"
+
+using namespace xmunch;
+
+BloomFilter::BloomFilter() : blocks(nullptr), block_count(0), capacity(0), size(0) {
+	reset(0);
+}
+
+void BloomFilter::reset(size_t keys) {
+	capacity = keys < 64 ? 64 : keys;
+	size = 0;
+	block_count = (capacity * BITS_PER_KEY + BLOCK_WORDS * 64 - 1) / (BLOCK_WORDS * 64);
+
+	// One extra block to align the first one to a cache line.
+	data.assign((block_count + 1) * BLOCK_WORDS, 0);
+	uintptr_t p = reinterpret_cast<uintptr_t>(data.data());
+	blocks = reinterpret_cast<uint64_t*>((p + 63) & ~uintptr_t(63));
+}
+
+uint64_t BloomFilter::bits(size_t hash) {
+	// Mix again, the block index already used the low bits of hash.
+	uint64_t h = static_cast<uint64_t>(hash);
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+void BloomFilter::insert(size_t hash) {
+	uint64_t* b = blocks + (hash % block_count) * BLOCK_WORDS;
+	uint64_t h = bits(hash);
+	for (size_t i = 0; i < BLOCK_WORDS; i++) {
+		b[i] |= uint64_t(1) << ((h >> (6 * i)) & 63);
+	}
+	size++;
+}
+
+bool BloomFilter::mayContain(size_t hash) const {
+	const uint64_t* b = blocks + (hash % block_count) * BLOCK_WORDS;
+	uint64_t h = bits(hash);
+	for (size_t i = 0; i < BLOCK_WORDS; i++) {
+		if (!(b[i] & (uint64_t(1) << ((h >> (6 * i)) & 63)))) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,69 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_BLOOM_FILTER_H_
+#define _XMUNCH_BLOOM_FILTER_H_
+
+#include "xmunch.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace xmunch {
+
+	/**
+	 * Bloom filter split into cache line sized blocks. A key only touches
+	 * one block, setting one bit in each of its eight 64 bit words, so a
+	 * test costs a single cache access. Works on precomputed hashes.
+	 */
+	class BloomFilter {
+		static const size_t BLOCK_WORDS = 8;
+		static const size_t BITS_PER_KEY = 12;
+
+		std::vector<uint64_t> data;
+		uint64_t* blocks;
+		size_t block_count;
+
+		size_t capacity;
+		size_t size;
+
+		public:
+			BloomFilter();
+
+			// Reset to hold about keys keys.
+			void reset(size_t keys);
+
+			void insert(size_t hash);
+			bool mayContain(size_t hash) const;
+
+			// Load the block of hash into the cache.
+			void prefetch(size_t hash) const {
+				__builtin_prefetch(blocks + (hash % block_count) * BLOCK_WORDS);
+			}
+
+			// True if more keys have been inserted than planned, false
+			// positives get more likely then.
+			bool overfull() const { return size > capacity; }
+
+		protected:
+
+			static uint64_t bits(size_t hash);
+	};
+}
+
+#endif /* ifndef _XMUNCH_BLOOM_FILTER_H_ */
@@ -0,0 +1,521 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "compressed-stream.h"
+#include "trace.h"
+
+#include <iostream>
+#include <fstream>
+#include <streambuf>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+
+#ifdef XMUNCH_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef XMUNCH_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace xmunch;
+
+static const size_t CHUNK = 1 << 16;
+
+static Compression detect(const char* magic, size_t n) {
+	const unsigned char* m = reinterpret_cast<const unsigned char*>(magic);
+	if (n >= 2 && m[0] == 0x1f && m[1] == 0x8b) {
+		return Compression::GZIP;
+	}
+	if (n >= 4 && m[0] == 0x28 && m[1] == 0xb5 && m[2] == 0x2f && m[3] == 0xfd) {
+		return Compression::ZSTD;
+	}
+	return Compression::NONE;
+}
+
+static bool ends_with(const String& s, const String& e) {
+	return s.length() >= e.length() && s.compare(s.length() - e.length(), e.length(), e) == 0;
+}
+
+bool xmunch::compression_supported(Compression c) {
+	switch (c) {
+		case Compression::NONE:
+			return true;
+		case Compression::GZIP:
+#ifdef XMUNCH_WITH_ZLIB
+			return true;
+#else
+			return false;
+#endif
+		case Compression::ZSTD:
+#ifdef XMUNCH_WITH_ZSTD
+			return true;
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+namespace {
+
+	/**
+	 * Reads from src and decompresses. The format is detected from the first
+	 * bytes, uncompressed data is passed through. Damaged, truncated or
+	 * unsupported data sets badbit on stream.
+	 */
+	class DecompressBuf : public std::streambuf {
+		std::streambuf* src;
+		std::istream* stream;
+
+		std::vector<char> in;
+		std::vector<char> out;
+		size_t in_pos;
+		size_t in_len;
+
+		Compression format;
+		bool started;
+		bool finished;
+		bool at_end; // After a complete gzip member or zstd frame
+
+#ifdef XMUNCH_WITH_ZLIB
+		z_stream zs;
+#endif
+#ifdef XMUNCH_WITH_ZSTD
+		ZSTD_DStream* zd;
+#endif
+
+		public:
+			DecompressBuf(std::streambuf* s, std::istream* st) : src(s), stream(st),
+				in(CHUNK), out(CHUNK), in_pos(0), in_len(0), format(Compression::NONE),
+				started(false), finished(false), at_end(false) {
+#ifdef XMUNCH_WITH_ZLIB
+				std::memset(&zs, 0, sizeof(zs));
+#endif
+#ifdef XMUNCH_WITH_ZSTD
+				zd = nullptr;
+#endif
+			}
+
+			~DecompressBuf() {
+#ifdef XMUNCH_WITH_ZLIB
+				if (format == Compression::GZIP) {
+					inflateEnd(&zs);
+				}
+#endif
+#ifdef XMUNCH_WITH_ZSTD
+				if (zd != nullptr) {
+					ZSTD_freeDStream(zd);
+				}
+#endif
+			}
+
+		protected:
+
+			void fail(const String& message) {
+				std::cerr << message << std::endl;
+				finished = true;
+				stream->setstate(std::ios::badbit);
+			}
+
+			bool fill() {
+				if (in_pos < in_len) {
+					return true;
+				}
+				in_pos = 0;
+				in_len = src->sgetn(in.data(), in.size());
+				return in_len > 0;
+			}
+
+			bool start() {
+				started = true;
+				// Make sure there are enough bytes to see the magic number.
+				in_len = 0;
+				while (in_len < 4) {
+					std::streamsize n = src->sgetn(in.data() + in_len, in.size() - in_len);
+					if (n <= 0) {
+						break;
+					}
+					in_len += n;
+				}
+				format = detect(in.data(), in_len);
+				if (!compression_supported(format)) {
+					fail("Error, the input is compressed, but xmunch was built without support for it.");
+					return false;
+				}
+#ifdef XMUNCH_WITH_ZLIB
+				if (format == Compression::GZIP) {
+					// 15 + 32: any window size, detect gzip or zlib header.
+					inflateInit2(&zs, 15 + 32);
+				}
+#endif
+#ifdef XMUNCH_WITH_ZSTD
+				if (format == Compression::ZSTD) {
+					zd = ZSTD_createDStream();
+					ZSTD_initDStream(zd);
+				}
+#endif
+				return true;
+			}
+
+			// Decompress into out, returns the number of bytes produced. The
+			// compressed data has to end after a complete member or frame.
+			size_t produce() {
+				if (format == Compression::NONE) {
+					if (!fill()) {
+						return 0;
+					}
+					size_t n = in_len - in_pos;
+					std::memcpy(out.data(), in.data() + in_pos, n);
+					in_pos = in_len;
+					return n;
+				}
+
+#ifdef XMUNCH_WITH_ZLIB
+				if (format == Compression::GZIP) {
+					while (true) {
+						// Without input, inflate might still have output left.
+						bool more = fill();
+						if (!more && at_end) {
+							return 0;
+						}
+						zs.next_in = reinterpret_cast<Bytef*>(in.data() + in_pos);
+						zs.avail_in = in_len - in_pos;
+						zs.next_out = reinterpret_cast<Bytef*>(out.data());
+						zs.avail_out = out.size();
+
+						int r = inflate(&zs, Z_NO_FLUSH);
+						in_pos = in_len - zs.avail_in;
+						size_t n = out.size() - zs.avail_out;
+
+						at_end = r == Z_STREAM_END;
+						if (at_end) {
+							// Concatenated gzip files are valid gzip data.
+							inflateReset(&zs);
+						} else if (r != Z_OK && r != Z_BUF_ERROR) {
+							fail(String("Error decompressing gzip input: ") +
+								(zs.msg ? zs.msg : "unknown error"));
+							return n;
+						}
+						if (n > 0) {
+							return n;
+						}
+						if (!more && !at_end) {
+							fail("Error decompressing gzip input: the data is truncated");
+							return 0;
+						}
+					}
+				}
+#endif
+
+#ifdef XMUNCH_WITH_ZSTD
+				if (format == Compression::ZSTD) {
+					while (true) {
+						bool more = fill();
+						if (!more && at_end) {
+							return 0;
+						}
+						ZSTD_inBuffer ib = {in.data(), in_len, in_pos};
+						ZSTD_outBuffer ob = {out.data(), out.size(), 0};
+						size_t r = ZSTD_decompressStream(zd, &ob, &ib);
+						in_pos = ib.pos;
+						if (ZSTD_isError(r)) {
+							fail(String("Error decompressing zstd input: ") + ZSTD_getErrorName(r));
+							return ob.pos;
+						}
+						// 0 once a frame is decoded and flushed completely.
+						at_end = r == 0;
+						if (ob.pos > 0) {
+							return ob.pos;
+						}
+						if (!more && !at_end) {
+							fail("Error decompressing zstd input: the data is truncated");
+							return 0;
+						}
+					}
+				}
+#endif
+				return 0;
+			}
+
+			int_type underflow() override {
+				if (gptr() < egptr()) {
+					return traits_type::to_int_type(*gptr());
+				}
+				if (!started && !start()) {
+					return traits_type::eof();
+				}
+				if (finished) {
+					return traits_type::eof();
+				}
+
+				size_t n = produce();
+				if (n == 0) {
+					finished = true;
+					return traits_type::eof();
+				}
+				setg(out.data(), out.data(), out.data() + n);
+				return traits_type::to_int_type(*gptr());
+			}
+	};
+
+	/**
+	 * Collects the output in chunks and hands them to a background thread,
+	 * which compresses and writes them to dst.
+	 */
+	class CompressBuf : public std::streambuf {
+		std::ostream& dst;
+		Compression format;
+
+		std::vector<char> chunk;
+
+		std::deque<std::vector<char> > queue;
+		std::mutex lock;
+		std::condition_variable changed;
+		bool closing;
+
+		std::thread worker;
+
+		static const size_t MAX_QUEUED = 8;
+
+		public:
+			CompressBuf(std::ostream& d, Compression f) : dst(d), format(f), chunk(CHUNK), closing(false) {
+				setp(chunk.data(), chunk.data() + chunk.size());
+				worker = std::thread(&CompressBuf::run, this);
+			}
+
+			~CompressBuf() {
+				close();
+			}
+
+			void close() {
+				if (!worker.joinable()) {
+					return;
+				}
+				handOff();
+				{
+					std::unique_lock<std::mutex> l(lock);
+					closing = true;
+				}
+				changed.notify_all();
+				worker.join();
+			}
+
+		protected:
+
+			int_type overflow(int_type c) override {
+				handOff();
+				if (!traits_type::eq_int_type(c, traits_type::eof())) {
+					*pptr() = traits_type::to_char_type(c);
+					pbump(1);
+				}
+				return traits_type::not_eof(c);
+			}
+
+			// Flushing (std::endl) doesn't hand off the chunk, that would
+			// make compression useless. Everything is written on close.
+			int sync() override {
+				return 0;
+			}
+
+			void handOff() {
+				size_t n = pptr() - pbase();
+				if (n == 0) {
+					return;
+				}
+				std::vector<char> full(chunk.begin(), chunk.begin() + n);
+				{
+					std::unique_lock<std::mutex> l(lock);
+					changed.wait(l, [this] () { return queue.size() < MAX_QUEUED; });
+					queue.push_back(std::move(full));
+				}
+				changed.notify_all();
+				setp(chunk.data(), chunk.data() + chunk.size());
+			}
+
+			void run() {
+				Trace::setThreadName("compression");
+				std::vector<char> out(CHUNK);
+#ifdef XMUNCH_WITH_ZLIB
+				z_stream zs;
+				std::memset(&zs, 0, sizeof(zs));
+				if (format == Compression::GZIP) {
+					// 15 + 16: gzip header
+					deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+				}
+#endif
+#ifdef XMUNCH_WITH_ZSTD
+				ZSTD_CStream* zc = nullptr;
+				if (format == Compression::ZSTD) {
+					zc = ZSTD_createCStream();
+					ZSTD_initCStream(zc, 3);
+				}
+#endif
+
+				while (true) {
+					std::vector<char> data;
+					bool last = false;
+					{
+						std::unique_lock<std::mutex> l(lock);
+						changed.wait(l, [this] () { return !queue.empty() || closing; });
+						if (!queue.empty()) {
+							data = std::move(queue.front());
+							queue.pop_front();
+						}
+						last = queue.empty() && closing;
+					}
+					changed.notify_all();
+					Trace::Span span("compress block");
+
+#ifdef XMUNCH_WITH_ZLIB
+					if (format == Compression::GZIP) {
+						zs.next_in = reinterpret_cast<Bytef*>(data.data());
+						zs.avail_in = data.size();
+						int flush = last ? Z_FINISH : Z_NO_FLUSH;
+						int r;
+						do {
+							zs.next_out = reinterpret_cast<Bytef*>(out.data());
+							zs.avail_out = out.size();
+							r = deflate(&zs, flush);
+							dst.write(out.data(), out.size() - zs.avail_out);
+						} while (zs.avail_out == 0 || (last && r != Z_STREAM_END));
+					}
+#endif
+#ifdef XMUNCH_WITH_ZSTD
+					if (format == Compression::ZSTD) {
+						ZSTD_inBuffer ib = {data.data(), data.size(), 0};
+						while (ib.pos < ib.size) {
+							ZSTD_outBuffer ob = {out.data(), out.size(), 0};
+							ZSTD_compressStream(zc, &ob, &ib);
+							dst.write(out.data(), ob.pos);
+						}
+						if (last) {
+							size_t left;
+							do {
+								ZSTD_outBuffer ob = {out.data(), out.size(), 0};
+								left = ZSTD_endStream(zc, &ob);
+								dst.write(out.data(), ob.pos);
+							} while (left > 0 && !ZSTD_isError(left));
+						}
+					}
+#endif
+					if (last) {
+						break;
+					}
+				}
+
+#ifdef XMUNCH_WITH_ZLIB
+				if (format == Compression::GZIP) {
+					deflateEnd(&zs);
+				}
+#endif
+#ifdef XMUNCH_WITH_ZSTD
+				if (zc != nullptr) {
+					ZSTD_freeCStream(zc);
+				}
+#endif
+				dst.flush();
+			}
+	};
+
+	class FilteredInput : public std::istream {
+		std::istream* file;
+		DecompressBuf buf;
+
+		public:
+			FilteredInput(std::istream* f, std::streambuf* src) : std::istream(nullptr), file(f), buf(src, this) {
+				rdbuf(&buf);
+			}
+
+			~FilteredInput() {
+				delete file;
+			}
+	};
+
+	class FilteredOutput : public std::ostream {
+		std::ostream* file;
+		CompressBuf buf;
+
+		public:
+			FilteredOutput(std::ostream* f, Compression c) : std::ostream(nullptr), file(f), buf(*f, c) {
+				rdbuf(&buf);
+			}
+
+			~FilteredOutput() {
+				buf.close();
+				if (file != &std::cout) {
+					delete file;
+				}
+			}
+	};
+}
+
+std::istream* xmunch::open_input(const String& name) {
+	if (name == "-") {
+		return new FilteredInput(nullptr, std::cin.rdbuf());
+	}
+
+	std::ifstream* f = new std::ifstream(name, std::ios::binary);
+	if (f->fail()) {
+		delete f;
+		return nullptr;
+	}
+
+	char magic[4];
+	f->read(magic, 4);
+	Compression c = detect(magic, f->gcount());
+	f->clear();
+	f->seekg(0);
+
+	if (c == Compression::NONE) {
+		return f;
+	}
+	return new FilteredInput(f, f->rdbuf());
+}
+
+std::ostream* xmunch::open_output(const String& name) {
+	Compression c = Compression::NONE;
+	if (ends_with(name, ".gz")) {
+		c = Compression::GZIP;
+	} else if (ends_with(name, ".zst")) {
+		c = Compression::ZSTD;
+	}
+
+	if (!compression_supported(c)) {
+		std::cerr << "Warning, xmunch was built without support for compressing "
+			<< name << ", writing it uncompressed." << std::endl;
+		c = Compression::NONE;
+	}
+
+	std::ostream* f = &std::cout;
+	if (name != "-") {
+		f = new std::ofstream(name, std::ios::binary);
+		if (f->fail()) {
+			delete f;
+			return nullptr;
+		}
+	}
+
+	if (c == Compression::NONE) {
+		return f;
+	}
+	return new FilteredOutput(f, c);
+}
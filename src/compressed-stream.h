@@ -0,0 +1,49 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_COMPRESSED_STREAM_H_
+#define _XMUNCH_COMPRESSED_STREAM_H_
+
+#include "xmunch.h"
+
+#include <istream>
+#include <ostream>
+
+namespace xmunch {
+
+	enum class Compression : char {
+		NONE,
+		GZIP,
+		ZSTD
+	};
+
+	// Open name for reading, - is standard input. gzip and zstd data is
+	// detected and decompressed while reading. Returns nullptr if the file
+	// can't be opened. The stream has to be deleted, unless it is std::cin.
+	std::istream* open_input(const String& name);
+
+	// Open name for writing, - is standard output. Names ending in .gz or
+	// .zst are compressed on a background thread. Returns nullptr if the
+	// file can't be opened. The stream has to be deleted, unless it is
+	// std::cout, to finish writing.
+	std::ostream* open_output(const String& name);
+
+	bool compression_supported(Compression c);
+}
+
+#endif /* ifndef _XMUNCH_COMPRESSED_STREAM_H_ */
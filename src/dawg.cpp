@@ -0,0 +1,173 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "dawg.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace xmunch;
+
+namespace {
+	// A state of the automaton while it is built.
+	struct BuildState {
+		bool final = false;
+		std::vector<std::pair<unsigned char, uint32_t> > edges;
+
+		// Equal states have equal signatures: the final flag and the
+		// labels and targets of the edges.
+		String signature() const {
+			String s(1, final ? '1' : '0');
+			for (auto& e : edges) {
+				s += static_cast<char>(e.first);
+				s.append(reinterpret_cast<const char*>(&e.second), sizeof(e.second));
+			}
+			return s;
+		}
+	};
+
+	/**
+	 * Incremental construction from sorted words (Daciuk et al.): the path
+	 * of the previous word which isn't shared with the next one can't
+	 * change anymore and is merged with equal registered states.
+	 */
+	class DawgBuilder {
+		public:
+			std::vector<BuildState> states;
+			std::vector<uint32_t> free_states;
+			std::unordered_map<String, uint32_t> registry;
+			// Registered states, children always before their parents.
+			std::vector<uint32_t> order;
+			// The path of the last word: state and the edge to its child.
+			std::vector<uint32_t> path;
+
+			DawgBuilder() : states(1), path(1, 0) {}
+
+			uint32_t newState() {
+				if (!free_states.empty()) {
+					uint32_t s = free_states.back();
+					free_states.pop_back();
+					return s;
+				}
+				states.emplace_back();
+				return states.size() - 1;
+			}
+
+			// Replace or register the states of path below depth.
+			void minimize(size_t depth) {
+				while (path.size() > depth + 1) {
+					uint32_t child = path.back();
+					path.pop_back();
+					BuildState& parent = states[path.back()];
+
+					String sig = states[child].signature();
+					auto r = registry.find(sig);
+					if (r != registry.end()) {
+						parent.edges.back().second = r->second;
+						states[child] = BuildState();
+						free_states.push_back(child);
+					} else {
+						registry.emplace(std::move(sig), child);
+						order.push_back(child);
+					}
+				}
+			}
+
+			void add(const String& w, size_t common) {
+				minimize(common);
+				for (size_t i = common; i < w.length(); i++) {
+					uint32_t s = newState();
+					states[path.back()].edges.emplace_back(static_cast<unsigned char>(w[i]), s);
+					path.push_back(s);
+				}
+				states[path.back()].final = true;
+			}
+	};
+}
+
+void Dawg::build(const std::vector<const String*>& sorted) {
+	DawgBuilder b;
+	const String* prev = nullptr;
+	for (auto w : sorted) {
+		size_t common = 0;
+		if (prev != nullptr) {
+			while (common < prev->length() && common < w->length() && (*prev)[common] == (*w)[common]) {
+				common++;
+			}
+		}
+		b.add(*w, common);
+		prev = w;
+	}
+	b.minimize(0);
+	b.order.push_back(0); // The root comes last.
+	b.registry.clear();
+
+	// Number the states in registration order and count their words.
+	std::vector<uint32_t> number(b.states.size());
+	std::vector<uint32_t> count(b.order.size());
+	size_t edges = 0;
+	for (auto n : b.order) {
+		edges += b.states[n].edges.size();
+	}
+	first.clear();
+	first.reserve(b.order.size() + 1);
+	first.push_back(0);
+	transitions.clear();
+	transitions.reserve(edges);
+	final.clear();
+	final.reserve(b.order.size());
+	for (size_t n = 0; n < b.order.size(); n++) {
+		BuildState& s = b.states[b.order[n]];
+		number[b.order[n]] = n;
+
+		uint32_t c = s.final ? 1 : 0;
+		for (auto& e : s.edges) {
+			uint32_t t = number[e.second];
+			transitions.push_back({e.first, t, c});
+			c += count[t];
+		}
+		count[n] = c;
+		final.push_back(s.final);
+		first.push_back(transitions.size());
+		s = BuildState();
+	}
+	root = b.order.size() - 1;
+	words = count[root];
+}
+
+size_t Dawg::find(const String& w) const {
+	if (first.size() < 2) {
+		return NOT_FOUND;
+	}
+
+	uint32_t s = root;
+	size_t id = 0;
+	for (unsigned char c : w) {
+		auto begin = transitions.begin() + first[s];
+		auto end = transitions.begin() + first[s + 1];
+		auto t = std::lower_bound(begin, end, c, [] (const Transition& t, unsigned char l) {
+				return t.label < l;
+			});
+		if (t == end || t->label != c) {
+			return NOT_FOUND;
+		}
+		id += t->before;
+		s = t->target;
+	}
+	return final[s] ? id : NOT_FOUND;
+}
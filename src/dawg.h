@@ -0,0 +1,72 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_DAWG_H_
+#define _XMUNCH_DAWG_H_
+
+#include "xmunch.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace xmunch {
+
+	/**
+	 * Minimal acyclic automaton (DAWG) of a set of words. Words sharing
+	 * prefixes or suffixes share states, so inflected word lists need much
+	 * less memory than in a hash table. Every state knows how many words
+	 * it accepts, which makes the position of a word in byte order a
+	 * perfect hash: find returns it as the id of the word.
+	 */
+	class Dawg {
+		struct Transition {
+			unsigned char label;
+			uint32_t target;
+			uint32_t before; // Words accepted through smaller labels
+		};
+
+		template <class T>
+		using Vector = std::vector<T, TaggedAllocator<T, MemoryTag::INDEX> >;
+
+		// Transitions of state s are [first[s], first[s + 1]), sorted by
+		// label.
+		Vector<uint32_t> first;
+		Vector<Transition> transitions;
+		Vector<bool> final;
+		uint32_t root;
+		size_t words;
+
+		public:
+			static const size_t NOT_FOUND = size_t(-1);
+
+			Dawg() : root(0), words(0) {}
+
+			// sorted must be sorted bytewise (as unsigned char) and
+			// without duplicates.
+			void build(const std::vector<const String*>& sorted);
+
+			// The id of w, or NOT_FOUND.
+			size_t find(const String& w) const;
+
+			size_t size() const { return words; }
+			size_t stateCount() const { return final.size(); }
+			size_t transitionCount() const { return transitions.size(); }
+	};
+}
+
+#endif /* ifndef _XMUNCH_DAWG_H_ */
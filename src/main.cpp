@@ -19,104 +19,226 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <set>
+#include <vector>
 
 
 #include "xmunch.h"
-#include "word.h"
-#include "affix.h"
-#include "affix-parser.h"
-#include "premunched-loader.h"
+#include "munch.h"
+#include "alphabet.h"
+#include "compressed-stream.h"
+#include "trace.h"
 
 using namespace xmunch;
 
-void load_wordlist(std::istream& in, WordList& words, Index& index) {
-	String l;
-	std::getline(in, l);
-
-	int wordcount= 500;
-	try {
-		wordcount = std::stoi(l) + 1000;
-		std::getline(in, l);
-	} catch (std::invalid_argument &e) {
-		std::cerr << "WARNING, dictionary file should contain the number of words in the first line." << std::endl;
+// Read a whole input, so it can be used for more than one run.
+std::istream* buffer_input(std::istream* in) {
+	if (in == nullptr) {
+		return nullptr;
 	}
+	std::ostringstream s;
+	s << in->rdbuf();
+	return new std::istringstream(s.str());
+}
 
-	index.reserve(wordcount);
+// True if an input couldn't be read completely, like a damaged compressed
+// file. The reason has been printed while reading.
+bool read_failed(const std::istream* s) {
+	if (s != nullptr && s->bad()) {
+		std::cerr << "couldn't read all of the input, stopping." << std::endl;
+		return true;
+	}
+	return false;
+}
 
-	do {
-		words.emplace_front(l);
-		index.emplace(words.begin()->getWord(), *(words.begin()));
-	} while (std::getline(in, l));
+int work(std::istream& in, std::istream& aff, std::ostream& out, std::istream* pm, const Options& opt) {
+	Munch m(opt);
+	m.load(in, aff, pm);
+	if (read_failed(&in) || read_failed(&aff) || read_failed(pm)) {
+		return 1;
+	}
+	m.match();
+	return m.write(out) ? 0 : 1;
 }
 
-void work(std::istream& in, std::ifstream& aff, std::ostream& out, std::ifstream* pm, bool print_tree, bool no_compression) {
+// Run both engines on the same input and compare their results.
+int diff_engines(std::istream& in, std::istream& aff, std::ostream& out, std::istream* pm, const Options& opt) {
+	std::istream* bin = buffer_input(&in);
+	std::istream* baff = buffer_input(&aff);
+	std::istream* bpm = buffer_input(pm);
+	if (read_failed(&in) || read_failed(&aff) || read_failed(pm)) {
+		delete bin;
+		delete baff;
+		delete bpm;
+		return 1;
+	}
+
+	// The same input options, but no candidate limit and the tree only
+	// printed once.
+	Options ropt = opt;
+	ropt.engine = Engine::REFERENCE;
+	ropt.max_candidates = 0;
+	ropt.print_tree = false;
+	Munch reference(ropt);
+	reference.load(*bin, *baff, bpm);
+	reference.match();
 
-	WordList words;
-	Index index;
+	bin->clear();
+	bin->seekg(0);
+	baff->clear();
+	baff->seekg(0);
+	if (bpm) {
+		bpm->clear();
+		bpm->seekg(0);
+	}
 
-	WordList virtual_stems;
-	Index virtual_index;
+	Options oopt = opt;
+	oopt.engine = Engine::OPTIMIZED;
+	Munch optimized(oopt);
+	optimized.load(*bin, *baff, bpm);
+	optimized.match();
+	bool written = optimized.write(out);
 
-	AffixGroupList affixes;
+	bool same = Munch::compare(optimized, reference, std::cerr);
+	if (same) {
+		std::cerr << "engines agree" << std::endl;
+	}
 
-	load_wordlist(in, words, index);
+	delete bin;
+	delete baff;
+	delete bpm;
+	if (!written) {
+		return 1;
+	}
+	return same ? 0 : 2;
+}
 
-	AffixParser afp(aff, affixes);
-	afp.parse();
+// The name of a variant in output names: the file name of its word list,
+// without directory and extensions.
+String variant_name(const String& path) {
+	size_t b = path.find_last_of('/');
+	b = b == String::npos ? 0 : b + 1;
+	return path.substr(b, path.find('.', b) - b);
+}
 
-	if (pm != nullptr) {
-		PremunchedLoader pml(*pm, affixes, words, index, virtual_stems, virtual_index);
-		pml.load();
+// Match several word lists at once, writing one output per list. files
+// are the word lists, the affixes and the output name.
+int run_variants(const std::vector<String>& files, const Options& opt) {
+	if (files.size() < 3) {
+		std::cerr << "--variants needs at least one word list, the affixes and the output." << std::endl;
+		return 1;
+	}
+	size_t n = files.size() - 2;
+	if (n > 64) {
+		std::cerr << "--variants supports at most 64 word lists." << std::endl;
+		return 1;
+	}
+	const String& output = files.back();
+	size_t p = output.find('%');
+	if (p == String::npos) {
+		std::cerr << "with --variants, the output name must contain %, it is replaced by the name of the word list." << std::endl;
+		return 1;
 	}
 
-	if (print_tree) {
-		for (auto& a : affixes) {
-			a.print();
+	std::vector<std::istream*> in;
+	std::vector<std::ostream*> out;
+	std::istream* aff = nullptr;
+	std::set<String> names;
+	int ret = 0;
+	for (size_t i = 0; i < n && ret == 0; i++) {
+		String name = variant_name(files[i]);
+		String o = output.substr(0, p) + name + output.substr(p + 1);
+		if (!names.insert(name).second) {
+			std::cerr << "more than one word list would be written to " << o << std::endl;
+			ret = 1;
+		} else if (std::istream* s = open_input(files[i])) {
+			in.push_back(s);
+		} else {
+			std::cerr << "couldn't open word list: " << files[i] << std::endl;
+			ret = 1;
+		}
+		if (ret == 0) {
+			std::ostream* s = open_output(o);
+			if (s == nullptr) {
+				std::cerr << "couldn't open output file: " << o << std::endl;
+				ret = 1;
+			}
+			out.push_back(s);
 		}
 	}
-
-	for (auto& a: affixes) {
-		a.match(index, virtual_stems, virtual_index);
+	if (ret == 0) {
+		aff = open_input(files[n]);
+		if (aff == nullptr) {
+			std::cerr << "couldn't open affix definition file: " << files[n] << std::endl;
+			ret = 1;
+		}
 	}
 
-	for (auto& w : words) {
-		if (w.hasStem()) {
-			continue;
+	if (ret == 0) {
+		Munch m(opt);
+		m.loadVariants(in, *aff);
+		bool failed = read_failed(aff);
+		for (auto s : in) {
+			failed = failed || read_failed(s);
 		}
-		if (no_compression) {
-			w.format_uncompressed(out);
+		if (failed) {
+			ret = 1;
 		} else {
-			w.format(out);
+			m.matchVariants(out);
 		}
 	}
-	for (auto& w : virtual_stems) {
-		if (!w.isStem()) {
-			continue;
+
+	for (auto s : in) {
+		if (s != &std::cin) {
+			delete s;
 		}
-		if (no_compression) {
-			w.format_uncompressed(out);
-		} else {
-			w.format(out);
+	}
+	delete aff;
+	for (auto s : out) {
+		if (s != &std::cout) {
+			delete s;
 		}
 	}
+	return ret;
 }
 
 void print_help() {
 	std::cerr << "Usage: xmunch wordlist affixes output [premunched] [options]\n"
+		<< "       xmunch --variants wordlist... affixes output [options]\n"
 		<< "if output or word-list are -, read from/write to standard streams.\n"
+		<< "gzip and zstd compressed input is decompressed, output files ending in .gz or .zst are compressed.\n"
 		<< "premunched is an optional file containing already munched data in the format of --no-compression output\n "
 		<< "--print-tree to print the parsed affix definitions to stderr\n"
-		<< "--no-compression to do no affix compression, output derivatives grouped with their stems\n" << std::endl;
+		<< "--no-compression to do no affix compression, output derivatives grouped with their stems\n"
+		<< "--max-candidates=N to create at most N virtual stem candidates per affix group\n"
+		<< "--sorted[=bytewise|locale] to sort the output by word, bytewise (default) or using the current locale\n"
+		<< "--remap-alphabet to store every character in one byte internally (at most 255 different ones)\n"
+		<< "--query-index=FILE to write a binary table from every word to its stems and groups to FILE, for xmunch-query\n"
+		<< "--trace=FILE to write a timeline of the phases of the run to FILE, in Chrome trace event format\n"
+		<< "--stats to print statistics about the run to stderr\n"
+		<< "--mem-report to print the memory used by the word list, index, affix lists, scores and virtual stems after each phase\n"
+		<< "--engine=optimized|reference to select the matching engine, reference is slow but simple\n"
+		<< "--drop-empty to ignore empty lines of the word list\n"
+		<< "--drop-comments to ignore lines of the word list starting with #\n"
+		<< "--word-set=hash|dawg to keep the word list in a hash index or in a minimal automaton, which needs less memory\n"
+		<< "--global-resolver to match all affix groups first and then decide about the stems of all groups at once\n"
+		<< "--variants to match several word lists at once and write one output per list, % in output is replaced by the\n"
+		<< "  name of the word list (without directory and extensions)\n"
+		<< "--diff-engines to run both engines and report the first difference of their results to stderr\n"
+		<< "--verify to expand the result again and print a JSON summary of lost and new words to stderr\n" << std::endl;
 }
 
 int main(int argc, char * argv[]) {
-	bool print_tree = false;
-	bool no_compression = false;
+	Options opt;
+	bool diff = false;
+	bool variants = false;
+	String trace_file;
+	std::vector<String> files;
 
 	std::istream* in = nullptr;
-	std::ifstream* aff = nullptr;
+	std::istream* aff = nullptr;
 	std::ostream* out = nullptr;
-	std::ifstream* pm = nullptr;
+	std::istream* pm = nullptr;
 
 	// parse arguments
 	int fi = 0;
@@ -127,70 +249,152 @@ int main(int argc, char * argv[]) {
 			print_help();
 			return 0;
 		} else if (a == "--print-tree") {
-			print_tree = true;
+			opt.print_tree = true;
 			continue;
 		} else if (a == "--no-compression") {
-			no_compression = true;
+			opt.no_compression = true;
+			continue;
+		} else if (a == "--verify") {
+			opt.verify = true;
+			continue;
+		} else if (a == "--sorted" || a == "--sorted=bytewise") {
+			opt.sort_order = SortOrder::BYTEWISE;
+			continue;
+		} else if (a == "--sorted=locale") {
+			opt.sort_order = SortOrder::LOCALE;
+			continue;
+		} else if (a == "--remap-alphabet") {
+			Alphabet::enable();
+			continue;
+		} else if (a == "--mem-report") {
+			MemoryReport::enable();
+			continue;
+		} else if (a == "--stats") {
+			opt.print_stats = true;
+			continue;
+		} else if (a == "--engine=optimized") {
+			opt.engine = Engine::OPTIMIZED;
+			continue;
+		} else if (a == "--engine=reference") {
+			opt.engine = Engine::REFERENCE;
+			continue;
+		} else if (a == "--drop-empty") {
+			opt.drop_empty = true;
+			continue;
+		} else if (a == "--drop-comments") {
+			opt.drop_comments = true;
+			continue;
+		} else if (a == "--word-set=hash") {
+			opt.word_set = WordSetType::HASH;
+			continue;
+		} else if (a == "--word-set=dawg") {
+			opt.word_set = WordSetType::DAWG;
+			continue;
+		} else if (a == "--global-resolver") {
+			opt.global_resolver = true;
+			continue;
+		} else if (a == "--diff-engines") {
+			diff = true;
+			continue;
+		} else if (a == "--variants") {
+			variants = true;
+			continue;
+		} else if (a.compare(0, 14, "--query-index=") == 0) {
+			opt.query_index = a.substr(14);
+			continue;
+		} else if (a.compare(0, 8, "--trace=") == 0) {
+			trace_file = a.substr(8);
+			Trace::enable();
+			continue;
+		} else if (a.compare(0, 17, "--max-candidates=") == 0) {
+			try {
+				opt.max_candidates = std::stoul(a.substr(17));
+			} catch (std::exception &e) {
+				std::cerr << "invalid number in " << a << std::endl;
+				return 1;
+			}
 			continue;
 		}
 
-		switch (fi) {
-			case 0: // word list
-				if (a == "-") {
-					in = &std::cin;
-				} else {
-					in = new std::ifstream(a);
-					if (in->fail()) {
+		files.push_back(a);
+	}
+
+	// do the work
+	int ret;
+	if (variants) {
+		if (diff || opt.verify || !opt.query_index.empty()) {
+			std::cerr << "--variants can't be used with --diff-engines, --verify or --query-index." << std::endl;
+			return 1;
+		}
+		ret = run_variants(files, opt);
+	} else {
+		for (auto& a : files) {
+			switch (fi) {
+				case 0: // word list
+					in = open_input(a);
+					if (in == nullptr) {
 						std::cerr << "couldn't open word list: " << a << std::endl;
 						return 1;
 					}
-				}
-				break;
-			case 1: // affix definitions
-				aff = new std::ifstream(a);
-				if (aff->fail()) {
-					std::cerr << "couldn't open affix definition file: " << a << std::endl;
-					return 1;
-				}
-				break;
-			case 2: // output
-				if (a == "-") {
-					out = &std::cout;
-				} else {
-					out = new std::ofstream(a);
-					if (out->fail()) {
+					break;
+				case 1: // affix definitions
+					aff = open_input(a);
+					if (aff == nullptr) {
+						std::cerr << "couldn't open affix definition file: " << a << std::endl;
+						return 1;
+					}
+					break;
+				case 2: // output
+					out = open_output(a);
+					if (out == nullptr) {
 						std::cerr << "couldn't open output file: " << a << std::endl;
 						return 1;
 					}
-				}
-				break;
-			case 3: // premunched data
-				pm = new std::ifstream(a);
-				if (pm->fail()) {
-					std::cerr << "couldn't open premunched input file: " << a << std::endl;
+					break;
+				case 3: // premunched data
+					pm = open_input(a);
+					if (pm == nullptr) {
+						std::cerr << "couldn't open premunched input file: " << a << std::endl;
+						return 1;
+					}
+					break;
+				default:
+					std::cout << "Too many arguments." << std::endl;
+					print_help();
 					return 1;
-				}
-				break;
-			default:
-				std::cout << "Too many arguments." << std::endl;
-				print_help();
-				return 1;
+			}
+			fi++;
 		}
-		fi++;
-	}
 
-	// do the work
-	work(*in, *aff, *out, pm, print_tree, no_compression);
+		if (diff) {
+			ret = diff_engines(*in, *aff, *out, pm, opt);
+		} else {
+			ret = work(*in, *aff, *out, pm, opt);
+		}
 
-	// clean up
-	if (in && in != &std::cin) {
-		delete in;
-	}
-	if (aff) {
-		delete aff;
+		// clean up
+		if (in && in != &std::cin) {
+			delete in;
+		}
+		if (aff) {
+			delete aff;
+		}
+		if (pm) {
+			delete pm;
+		}
+		if (out && out != &std::cout) {
+			delete out;
+		}
 	}
-	if (out && out != &std::cout) {
-		delete out;
+
+	// After closing the output, its compression thread is done.
+	if (!trace_file.empty()) {
+		std::ofstream t(trace_file);
+		if (!t) {
+			std::cerr << "couldn't open trace file: " << trace_file << std::endl;
+			return 1;
+		}
+		Trace::write(t);
 	}
+	return ret;
 }
-
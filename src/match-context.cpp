@@ -0,0 +1,227 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "match-context.h"
+
+#include "affix.h"
+#include "word.h"
+
+#include <functional>
+#include <iostream>
+
+using namespace xmunch;
+
+namespace {
+	// Enough stems to keep the loads of a few steps going at once, few
+	// enough that the lines they need stay in the L1 cache.
+	const size_t PROBE_BATCH = 32;
+}
+
+/** MatchContext **/
+
+MatchContext::MatchContext(
+		const WordSet& w,
+		WordList& vs,
+		Index& vi,
+		const SortedIndex& si,
+		Stats& st
+	) : probes(PROBE_BATCH), queued(0), filter_stale(0), candidates(MemoryTag::VIRTUAL), candidate_index(MemoryTag::VIRTUAL),
+		max_candidates(0), group_candidates(0), capped(false), engine(Engine::OPTIMIZED),
+		words(w), vstems(vs), vindex(vi), sorted(si), stats(st), resolver(nullptr), variants(0) {
+	rebuildFilter();
+}
+
+void MatchContext::rebuildFilter() {
+	// Leave some room for virtual stems added while matching.
+	size_t n = words.size() + vindex.size();
+	filter.reset(n + n / 2);
+
+	WordHash hash;
+	for (auto w : words.all()) {
+		filter.insert(hash(w->getWord()));
+	}
+	for (auto& w : vindex) {
+		filter.insert(hash(w.first));
+	}
+	for (auto& w : candidate_index) {
+		filter.insert(hash(w.first));
+	}
+	filter_stale = 0;
+}
+
+StemLookup MatchContext::find(const String& stem) {
+	stats.stem_probes++;
+
+	return lookup(stem, WordHash()(stem));
+}
+
+void MatchContext::queueProbe(Affix& a, const String& stem, Word& w) {
+	Probe& p = probes[queued++];
+	p.affix = &a;
+	p.word = &w;
+	p.stem.assign(stem); // Reuses the buffer of an earlier probe
+	p.hash = WordHash()(stem);
+	filter.prefetch(p.hash);
+	if (words.getType() == WordSetType::HASH) {
+		words.prefetch(p.hash);
+	}
+	if (queued == probes.size()) {
+		flushProbes();
+	}
+}
+
+void MatchContext::flushProbes() {
+	size_t n = queued;
+	queued = 0;
+	bool hash = words.getType() == WordSetType::HASH;
+
+	// Filter blocks and table slots are loaded by now, find the words
+	// with the same hash and load them, then their characters.
+	for (size_t i = 0; i < n; i++) {
+		Probe& p = probes[i];
+		p.found = nullptr;
+		if (hash && filter.mayContain(p.hash)) {
+			p.found = words.candidate(p.hash);
+			if (p.found != nullptr) {
+				__builtin_prefetch(p.found);
+			}
+		}
+	}
+	if (hash) {
+		for (size_t i = 0; i < n; i++) {
+			if (probes[i].found != nullptr) {
+				__builtin_prefetch(probes[i].found->getWord().data());
+			}
+		}
+	}
+
+	// In order, a match might add a virtual stem a later probe finds.
+	for (size_t i = 0; i < n; i++) {
+		Probe& p = probes[i];
+		stats.stem_probes++;
+		StemLookup r = {StemLookup::ABSENT, nullptr};
+		if (hash) {
+			if (p.found != nullptr) {
+				// A different word with the same hash is very unlikely.
+				Word* w = p.found->getWord() == p.stem ? p.found : words.find(p.stem, p.hash);
+				if (w != nullptr) {
+					r = {StemLookup::NORMAL, w};
+				}
+			}
+		} else if (filter.mayContain(p.hash)) {
+			Word* w = words.find(p.stem);
+			if (w != nullptr) {
+				r = {StemLookup::NORMAL, w};
+			}
+		}
+
+		if (r.kind == StemLookup::ABSENT) {
+			if (!filter.mayContain(p.hash)) {
+				stats.filter_rejects++;
+			} else {
+				r = lookupVirtual(p.stem);
+				if (r.kind == StemLookup::ABSENT) {
+					stats.filter_false_positives++;
+				}
+			}
+		}
+		p.affix->handleLookup(*this, p.stem, r, *p.word);
+	}
+}
+
+StemLookup MatchContext::lookup(const String& stem, size_t hash) {
+	Word* w = words.find(stem, hash);
+	if (w != nullptr) {
+		return {StemLookup::NORMAL, w};
+	}
+	return lookupVirtual(stem);
+}
+
+StemLookup MatchContext::lookupVirtual(const String& stem) {
+	auto v = vindex.find(stem);
+	if (v != vindex.end()) {
+		return {StemLookup::VIRTUAL, &v->second};
+	}
+	v = candidate_index.find(stem);
+	if (v != candidate_index.end()) {
+		return {StemLookup::VIRTUAL, &v->second};
+	}
+	return {StemLookup::ABSENT, nullptr};
+}
+
+bool MatchContext::isPartial(const Word& w) const {
+	return variants != 0 && (w.getVariants() & variants) != variants;
+}
+
+Word* MatchContext::addVirtual(const String& stem) {
+	if (max_candidates != 0 && group_candidates >= max_candidates) {
+		if (!capped) {
+			std::cerr << "WARNING, reached the limit of " << max_candidates <<
+				" virtual stem candidates, ignoring further ones in this group." << std::endl;
+			capped = true;
+		}
+		stats.virtual_capped++;
+		return nullptr;
+	}
+
+	group_candidates++;
+	candidates.emplace_back(stem);
+	Word& w = candidates.back();
+	candidate_index.emplace(stem, w);
+	w.setStemType(StemType::UNDEFINED);
+	stats.virtual_candidates++;
+
+	if (engine == Engine::REFERENCE) {
+		return &w;
+	}
+
+	filter.insert(WordHash()(stem));
+	if (filter.overfull()) {
+		rebuildFilter();
+	}
+	return &w;
+}
+
+void MatchContext::startGroup() {
+	group_candidates = 0;
+	capped = false;
+}
+
+void MatchContext::finishGroup() {
+	candidate_index.clear();
+
+	auto i = candidates.begin();
+	while (i != candidates.end()) {
+		auto c = i++;
+		if (c->isStem()) {
+			// Splicing keeps the address, which confirmed words refer to.
+			vstems.splice(vstems.end(), candidates, c);
+			vindex.emplace(vstems.back().getWord(), vstems.back());
+			stats.virtual_stems++;
+		} else {
+			candidates.erase(c);
+			filter_stale++;
+		}
+	}
+
+	scratch.reset();
+
+	if (engine == Engine::OPTIMIZED && filter_stale > (words.size() + vindex.size()) / 4) {
+		rebuildFilter();
+	}
+}
@@ -0,0 +1,167 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_MATCH_CONTEXT_H_
+#define _XMUNCH_MATCH_CONTEXT_H_
+
+#include "xmunch.h"
+#include "sorted-index.h"
+#include "stats.h"
+#include "bloom-filter.h"
+#include "word-set.h"
+
+#include <vector>
+
+namespace xmunch {
+
+	class StemResolver;
+
+	enum class Engine : char {
+		OPTIMIZED,
+		// Word by word matching with plain lookups, no candidate ranges,
+		// batches or filter. Slow, but simple enough to check the other one.
+		REFERENCE
+	};
+
+	struct StemLookup {
+		enum Kind : char {
+			ABSENT,
+			NORMAL, // In the word list
+			VIRTUAL // In the virtual stem list
+		};
+
+		Kind kind;
+		Word* word;
+	};
+
+	/**
+	 * The state shared by all affixes while matching: the word list index,
+	 * the virtual stems and the helpers to look up candidate stems in them.
+	 *
+	 * The optimized engine looks candidate stems up in batches. Every lookup
+	 * in the word set is a few dependent cache misses (filter block, table
+	 * slot, word, its characters). Queued stems get their hash computed and
+	 * the first loads started at once; flushProbes then goes through the
+	 * batch once per step, so the loads of all stems of a batch overlap
+	 * instead of being waited for one by one.
+	 */
+	class MatchContext {
+		// A candidate stem queued by Affix::handleMatch.
+		struct Probe {
+			Affix* affix;
+			Word* word;
+			String stem;
+			size_t hash;
+			Word* found; // Word set entry with the same hash
+		};
+
+		std::vector<Probe> probes;
+		size_t queued;
+
+		// Contains all words and virtual stems, and maybe some dropped
+		// candidates.
+		BloomFilter filter;
+		size_t filter_stale;
+
+		// Virtual stems created by the current group. Only confirmed ones
+		// are moved to vstems when the group is finished.
+		WordList candidates;
+		Index candidate_index;
+		size_t max_candidates;
+		size_t group_candidates;
+		bool capped;
+
+		Engine engine;
+
+		public:
+			const WordSet& words;
+			WordList& vstems;
+			Index& vindex;
+			const SortedIndex& sorted;
+			Stats& stats;
+
+			// Scratch memory of the current group, reset by finishGroup.
+			Arena scratch;
+
+			// If set, matches are collected for all groups and resolved by
+			// it, finishGroup is called once afterwards.
+			StemResolver* resolver;
+
+			// With --variants, the bits of all word lists, 0 otherwise.
+			VariantSet variants;
+
+			MatchContext(
+					const WordSet& w,
+					WordList& vs,
+					Index& vi,
+					const SortedIndex& si,
+					Stats& st
+				);
+
+			// Limit the number of virtual stem candidates per group, 0
+			// means no limit.
+			void setMaxCandidates(size_t m) { max_candidates = m; }
+
+			void setEngine(Engine e) { engine = e; }
+			Engine getEngine() const { return engine; }
+
+			// Whether handleMatch should queue its stems.
+			bool batchesProbes() const { return engine == Engine::OPTIMIZED; }
+
+			// Look stem up right away, first in the word list, then in the
+			// virtual stems. The reference engine's lookup.
+			StemLookup find(const String& stem);
+
+			// Look stem up later and pass the result to
+			// a.handleLookup. Flushes the queue when it is full.
+			void queueProbe(Affix& a, const String& stem, Word& w);
+
+			// Look up all queued stems, in the order they were queued.
+			void flushProbes();
+
+			// True if w is missing in one of the variants, so it might
+			// still become a virtual stem there.
+			bool isPartial(const Word& w) const;
+
+			// Create a new virtual stem candidate, stem must not be known yet.
+			// Returns nullptr if the candidate limit is reached.
+			Word* addVirtual(const String& stem);
+
+			// The virtual stem candidates not confirmed or dropped yet.
+			WordList& getCandidates() { return candidates; }
+
+			// Called by groups before matching.
+			void startGroup();
+
+			// Called by groups after confirming their stems. Keeps confirmed
+			// virtual stem candidates and drops the others.
+			void finishGroup();
+
+		protected:
+
+			void rebuildFilter();
+
+			// Look stem up in the indexes, without the filter.
+			StemLookup lookup(const String& stem, size_t hash);
+
+			// Look stem up in the virtual stems and candidates only.
+			StemLookup lookupVirtual(const String& stem);
+	};
+}
+
+#endif /* ifndef _XMUNCH_MATCH_CONTEXT_H_ */
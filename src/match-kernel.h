@@ -0,0 +1,130 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_MATCH_KERNEL_H_
+#define _XMUNCH_MATCH_KERNEL_H_
+
+#include "xmunch.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace xmunch {
+
+	const size_t KEY_BYTES = 16;
+
+	/**
+	 * The first and last KEY_BYTES bytes of a word, zero padded. The tail is
+	 * right aligned, so the last byte of the word is always tail[15].
+	 */
+	struct alignas(16) WordKey {
+		unsigned char tail[KEY_BYTES];
+		unsigned char head[KEY_BYTES];
+
+		void set(const String& s) {
+			std::memset(tail, 0, KEY_BYTES);
+			std::memset(head, 0, KEY_BYTES);
+			size_t n = s.length() < KEY_BYTES ? s.length() : KEY_BYTES;
+			std::memcpy(tail + KEY_BYTES - n, s.data() + s.length() - n, n);
+			std::memcpy(head, s.data(), n);
+		}
+	};
+
+	/**
+	 * A suffix or prefix of at most KEY_BYTES bytes, compiled to a masked
+	 * compare against one half of a WordKey.
+	 */
+	class AffixKernel {
+		alignas(16) unsigned char pattern[KEY_BYTES];
+		uint64_t mask_lo;
+		uint64_t mask_hi;
+		unsigned mask_bits;
+		size_t length;
+		bool suffix;
+		bool usable;
+
+		public:
+			AffixKernel() : mask_lo(0), mask_hi(0), mask_bits(0), length(0),
+				suffix(true), usable(false) {
+				std::memset(pattern, 0, KEY_BYTES);
+			}
+
+			// Returns false if a does not fit, match has to fall back to a
+			// byte wise comparison in that case.
+			bool compile(const String& a, bool is_suffix) {
+				std::memset(pattern, 0, KEY_BYTES);
+				suffix = is_suffix;
+				length = a.length();
+				usable = length <= KEY_BYTES;
+				if (!usable) {
+					return false;
+				}
+
+				size_t off = suffix ? KEY_BYTES - length : 0;
+				std::memcpy(pattern + off, a.data(), length);
+
+				unsigned char m[KEY_BYTES] = {0};
+				std::memset(m + off, 0xff, length);
+				std::memcpy(&mask_lo, m, 8);
+				std::memcpy(&mask_hi, m + 8, 8);
+				mask_bits = 0;
+				for (size_t i = 0; i < KEY_BYTES; i++) {
+					if (m[i]) {
+						mask_bits |= 1u << i;
+					}
+				}
+				return true;
+			}
+
+			bool isUsable() const { return usable; }
+			size_t getLength() const { return length; }
+
+			bool matches(const WordKey& k, size_t word_length) const {
+				if (word_length < length) {
+					return false;
+				}
+				return compare(suffix ? k.tail : k.head);
+			}
+
+		protected:
+
+#ifdef __SSE2__
+			bool compare(const unsigned char* d) const {
+				__m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(d));
+				__m128i p = _mm_load_si128(reinterpret_cast<const __m128i*>(pattern));
+				unsigned eq = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, p)));
+				return (eq & mask_bits) == mask_bits;
+			}
+#else
+			bool compare(const unsigned char* d) const {
+				uint64_t lo, hi, plo, phi;
+				std::memcpy(&lo, d, 8);
+				std::memcpy(&hi, d + 8, 8);
+				std::memcpy(&plo, pattern, 8);
+				std::memcpy(&phi, pattern + 8, 8);
+				return (((lo ^ plo) & mask_lo) | ((hi ^ phi) & mask_hi)) == 0;
+			}
+#endif
+	};
+}
+
+#endif /* ifndef _XMUNCH_MATCH_KERNEL_H_ */
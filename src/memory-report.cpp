@@ -0,0 +1,96 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "memory-report.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace xmunch;
+
+bool MemoryReport::enabled = false;
+MemoryReport::Counter MemoryReport::counters[static_cast<size_t>(MemoryTag::COUNT)];
+
+static const char* tag_names[] = {"index", "words", "affixes", "scores", "virtual", "scratch", "other"};
+
+static double mib(size_t bytes) {
+	return bytes / (1024.0 * 1024.0);
+}
+
+void MemoryReport::print(std::ostream& out, const std::string& phase) {
+	if (!enabled) {
+		return;
+	}
+
+	std::ostringstream s;
+	s << "memory after " << phase << ":";
+	size_t total = 0;
+	for (size_t i = 0; i < static_cast<size_t>(MemoryTag::COUNT); i++) {
+		Counter& c = counters[i];
+		size_t cur = c.current.load();
+		total += cur;
+		s << " " << tag_names[i] << " " << std::fixed << std::setprecision(1)
+			<< mib(cur) << "M (peak " << mib(c.peak.load()) << "M, "
+			<< c.allocations.load() << " allocs)";
+
+		// The peak and allocations of the next phase start here.
+		c.peak = cur;
+		c.allocations = 0;
+	}
+	s << ", total " << mib(total) << "M";
+	out << s.str() << std::endl;
+}
+
+
+/** Arena **/
+
+Arena::~Arena() {
+	for (auto& b : blocks) {
+		MemoryReport::freed(MemoryTag::SCRATCH, b.second);
+		::operator delete(b.first);
+	}
+}
+
+char* Arena::grow(size_t bytes) {
+	// Double the block size up to 16 MiB, so big groups need few blocks.
+	size_t size = blocks.empty() ? 64 * 1024 : std::min<size_t>(blocks.back().second * 2, 16 << 20);
+	size = std::max(size, bytes);
+
+	char* b = static_cast<char*>(::operator new(size));
+	MemoryReport::allocated(MemoryTag::SCRATCH, size);
+	blocks.emplace_back(b, size);
+	pos = b;
+	end = b + size;
+	return b;
+}
+
+void Arena::reset() {
+	if (blocks.empty()) {
+		return;
+	}
+
+	// The last block is the biggest one.
+	for (size_t i = 0; i + 1 < blocks.size(); i++) {
+		MemoryReport::freed(MemoryTag::SCRATCH, blocks[i].second);
+		::operator delete(blocks[i].first);
+	}
+	blocks.erase(blocks.begin(), blocks.end() - 1);
+	pos = blocks.front().first;
+	end = pos + blocks.front().second;
+}
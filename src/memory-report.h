@@ -0,0 +1,185 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_MEMORY_REPORT_H_
+#define _XMUNCH_MEMORY_REPORT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace xmunch {
+
+	// The subsystems allocations are counted for.
+	enum class MemoryTag : char {
+		INDEX, // Word list index
+		WORDS, // Word list nodes
+		AFFIXES, // Per word affix lists and stem marks
+		SCORES, // Match scores of the current group
+		VIRTUAL, // Virtual stems and candidates with their indexes
+		SCRATCH, // Arena blocks used while matching a group
+		OTHER,
+		COUNT
+	};
+
+	/**
+	 * Counts the bytes allocated through TaggedAllocator per subsystem, if
+	 * enabled (--mem-report). Only the container nodes are counted, not
+	 * the characters of long words.
+	 */
+	class MemoryReport {
+		struct Counter {
+			std::atomic<size_t> current;
+			std::atomic<size_t> peak;
+			std::atomic<size_t> allocations;
+		};
+
+		static bool enabled;
+		static Counter counters[static_cast<size_t>(MemoryTag::COUNT)];
+
+		public:
+			static void enable() { enabled = true; }
+			static bool isEnabled() { return enabled; }
+
+			static void allocated(MemoryTag tag, size_t bytes) {
+				if (!enabled) {
+					return;
+				}
+				Counter& c = counters[static_cast<size_t>(tag)];
+				size_t cur = c.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+				size_t p = c.peak.load(std::memory_order_relaxed);
+				while (cur > p && !c.peak.compare_exchange_weak(p, cur, std::memory_order_relaxed)) {}
+				c.allocations.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			static void freed(MemoryTag tag, size_t bytes) {
+				if (!enabled) {
+					return;
+				}
+				counters[static_cast<size_t>(tag)].current.fetch_sub(bytes, std::memory_order_relaxed);
+			}
+
+			// Print current and peak bytes and the allocations of every
+			// subsystem since the last report, then start a new phase.
+			static void print(std::ostream& out, const std::string& phase);
+	};
+
+	/**
+	 * Monotonic allocator for data which only lives while one affix group is
+	 * matched. Freeing single allocations does nothing, reset() frees
+	 * everything at once and keeps the biggest block for the next group.
+	 */
+	class Arena {
+		std::vector<std::pair<char*, size_t> > blocks;
+		char* pos;
+		char* end;
+
+		public:
+			Arena() : pos(nullptr), end(nullptr) {}
+			~Arena();
+
+			Arena(const Arena&) = delete;
+			Arena& operator=(const Arena&) = delete;
+
+			void* allocate(size_t bytes, size_t align) {
+				char* p = alignUp(pos, align);
+				if (p == nullptr || p + bytes > end) {
+					p = alignUp(grow(bytes + align), align);
+				}
+				pos = p + bytes;
+				return p;
+			}
+
+			void reset();
+
+		protected:
+			static char* alignUp(char* p, size_t align) {
+				uintptr_t a = reinterpret_cast<uintptr_t>(p);
+				return reinterpret_cast<char*>((a + align - 1) & ~(uintptr_t(align) - 1));
+			}
+
+			// Start a new block with at least bytes free, returns its start.
+			char* grow(size_t bytes);
+	};
+
+	/**
+	 * std::allocator which counts its allocations for a subsystem. The tag
+	 * defaults to Default, so containers of containers (like the per word
+	 * affix lists) are tagged without passing allocators around. With an
+	 * arena, memory comes from the arena and is never freed singly.
+	 */
+	template <class T, MemoryTag Default = MemoryTag::OTHER>
+	class TaggedAllocator {
+		template <class U, MemoryTag D> friend class TaggedAllocator;
+
+		MemoryTag tag;
+		Arena* arena;
+
+		public:
+			typedef T value_type;
+
+			// Containers assigned from one using an arena use it too.
+			typedef std::true_type propagate_on_container_move_assignment;
+			typedef std::true_type propagate_on_container_swap;
+
+			template <class U>
+			struct rebind {
+				typedef TaggedAllocator<U, Default> other;
+			};
+
+			TaggedAllocator(MemoryTag t = Default, Arena* a = nullptr) : tag(t), arena(a) {}
+
+			template <class U>
+			TaggedAllocator(const TaggedAllocator<U, Default>& o) : tag(o.tag), arena(o.arena) {}
+
+			T* allocate(size_t n) {
+				if (arena != nullptr) {
+					return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+				}
+				MemoryReport::allocated(tag, n * sizeof(T));
+				return std::allocator<T>().allocate(n);
+			}
+
+			void deallocate(T* p, size_t n) {
+				if (arena != nullptr) {
+					return;
+				}
+				MemoryReport::freed(tag, n * sizeof(T));
+				std::allocator<T>().deallocate(p, n);
+			}
+
+			MemoryTag getTag() const { return tag; }
+			Arena* getArena() const { return arena; }
+
+			template <class U>
+			bool operator==(const TaggedAllocator<U, Default>& o) const {
+				return tag == o.tag && arena == o.arena;
+			}
+			template <class U>
+			bool operator!=(const TaggedAllocator<U, Default>& o) const {
+				return !(*this == o);
+			}
+	};
+}
+
+#endif /* ifndef _XMUNCH_MEMORY_REPORT_H_ */
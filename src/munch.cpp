@@ -0,0 +1,378 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "munch.h"
+#include "affix-parser.h"
+#include "premunched-loader.h"
+#include "verify.h"
+#include "sorted-index.h"
+#include "alphabet.h"
+#include "stem-resolver.h"
+#include "wordlist-loader.h"
+#include "trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <vector>
+
+using namespace xmunch;
+
+void Munch::load(std::istream& in, std::istream& aff, std::istream* pm) {
+	loadWords(in, 0);
+	prepare(aff, pm);
+}
+
+void Munch::loadVariants(const std::vector<std::istream*>& in, std::istream& aff) {
+	variant_words.resize(in.size());
+	for (size_t i = 0; i < in.size(); i++) {
+		loadWords(*in[i], i, &variant_words[i]);
+	}
+	prepare(aff, nullptr);
+}
+
+void Munch::loadWords(std::istream& in, size_t variant, std::vector<Word*>* order) {
+	WordListLoader wl(in, words, index);
+	wl.dropEmpty(opt.drop_empty);
+	wl.dropComments(opt.drop_comments);
+	wl.setVariant(variant);
+	if (order) {
+		wl.keepOrder(*order);
+	}
+	{
+		Trace::Span span("load word list");
+		wl.load();
+	}
+	const WordListLoader::Counts& c = wl.getCounts();
+	stats.input_lines += c.lines;
+	stats.trimmed_lines += c.trimmed;
+	stats.duplicate_lines += c.duplicates;
+	stats.dropped_lines += c.empty + c.comments;
+	if (variant != 0 || c.shared != 0) {
+		stats.variants.resize(variant + 1);
+		stats.variants[variant].shared_lines = c.shared;
+	}
+	MemoryReport::print(std::cerr, "loading the word list");
+}
+
+void Munch::prepare(std::istream& aff, std::istream* pm) {
+	{
+		Trace::Span span("parse affixes");
+		AffixParser afp(aff, affixes);
+		afp.parse();
+	}
+
+	if (pm != nullptr) {
+		Trace::Span span("load premunched data");
+		PremunchedLoader pml(*pm, affixes, words, index, virtual_stems, virtual_index);
+		pml.load();
+		MemoryReport::print(std::cerr, "loading premunched data");
+	}
+
+	{
+		Trace::Span span("build word set");
+		word_set.build(opt.word_set);
+		// The word set answers all lookups from now on.
+		Index().swap(index);
+	}
+	MemoryReport::print(std::cerr, "building the word set");
+
+	if (opt.print_tree) {
+		for (auto& a : affixes) {
+			a.print();
+		}
+	}
+}
+
+void Munch::startMatching(SortedIndex& sorted) {
+	if (opt.engine == Engine::OPTIMIZED) {
+		Trace::Span span("build sorted index");
+		sorted.build(word_set.all());
+	}
+
+	stats.words = word_set.size();
+	if (opt.word_set == WordSetType::DAWG) {
+		stats.dawg_states = word_set.getDawg().stateCount();
+		stats.dawg_transitions = word_set.getDawg().transitionCount();
+	}
+}
+
+void Munch::match() {
+	SortedIndex sorted;
+	startMatching(sorted);
+
+	MatchContext ctx(word_set, virtual_stems, virtual_index, sorted, stats);
+	ctx.setMaxCandidates(opt.max_candidates);
+	ctx.setEngine(opt.engine);
+	if (opt.global_resolver) {
+		StemResolver resolver(affixes, word_set);
+		ctx.resolver = &resolver;
+		for (auto& a: affixes) {
+			a.collect(ctx);
+			MemoryReport::print(std::cerr, "matching group " + a.getName());
+		}
+		{
+			Trace::Span span("resolve stems");
+			resolver.resolve();
+		}
+		ctx.finishGroup();
+		ctx.resolver = nullptr;
+		MemoryReport::print(std::cerr, "resolving the stems");
+		return;
+	}
+
+	for (auto& a: affixes) {
+		a.match(ctx);
+		MemoryReport::print(std::cerr, "group " + a.getName());
+	}
+}
+
+void Munch::matchVariants(const std::vector<std::ostream*>& out) {
+	SortedIndex sorted;
+	startMatching(sorted);
+	stats.variants.resize(out.size());
+
+	MatchContext ctx(word_set, virtual_stems, virtual_index, sorted, stats);
+	ctx.setMaxCandidates(opt.max_candidates);
+	ctx.setEngine(opt.engine);
+	ctx.variants = out.size() < 64 ? (VariantSet(1) << out.size()) - 1 : ~VariantSet(0);
+	StemResolver resolver(affixes, word_set);
+	ctx.resolver = &resolver;
+	for (auto& a: affixes) {
+		a.collect(ctx);
+		MemoryReport::print(std::cerr, "matching group " + a.getName());
+	}
+
+	// Virtual stem candidates stay in the context, words missing in a
+	// variant become candidates there.
+	WordList& candidates = ctx.getCandidates();
+	for (size_t i = 0; i < out.size(); i++) {
+		VariantSet v = VariantSet(1) << i;
+		String number = std::to_string(i + 1);
+		{
+			Trace::Span span("resolve stems", number);
+			for (auto& w : words) {
+				w.resetStem(w.inVariant(v) ? StemType::NORMAL : StemType::UNDEFINED);
+			}
+			for (auto& w : candidates) {
+				w.resetStem(StemType::UNDEFINED);
+			}
+			// Equally good stems are taken in the order of this list.
+			for (size_t j = 0; j < variant_words[i].size(); j++) {
+				variant_words[i][j]->setId(j);
+			}
+			resolver.resolve(v);
+		}
+		MemoryReport::print(std::cerr, "resolving variant " + std::to_string(i + 1));
+
+		Stats::Variant& s = stats.variants[i];
+		s.words = variant_words[i].size();
+		for (auto& w : words) {
+			if (w.inVariant(v)) {
+				s.stems += w.isStem();
+			} else {
+				s.virtual_stems += w.isStem();
+			}
+		}
+		for (auto& w : candidates) {
+			s.virtual_stems += w.isStem();
+		}
+		stats.virtual_stems += s.virtual_stems;
+
+		writeWords(*out[i], candidates, v);
+		MemoryReport::print(std::cerr, "writing variant " + std::to_string(i + 1));
+	}
+	ctx.resolver = nullptr;
+
+	if (opt.print_stats) {
+		if (Alphabet::isEnabled()) {
+			stats.alphabet = Alphabet::size();
+		}
+		stats.print(std::cerr);
+	}
+}
+
+void Munch::writeWords(std::ostream& out, WordList& vstems, VariantSet variant) {
+	Trace::Span span("write output");
+	std::vector<Word*> output;
+	collect_output(words, vstems, output, variant);
+	if (opt.sort_order != SortOrder::NONE) {
+		Trace::Span span("sort output");
+		sort_output(output, opt.sort_order);
+	}
+	write_output(out, output, opt.no_compression);
+}
+
+bool Munch::write(std::ostream& out) {
+	writeWords(out, virtual_stems, 0);
+	MemoryReport::print(std::cerr, "writing the output");
+
+	bool ok = true;
+	if (!opt.query_index.empty()) {
+		Trace::Span span("query index");
+		std::ofstream f(opt.query_index, std::ios::binary);
+		if (!f) {
+			std::cerr << "couldn't open query index file: " << opt.query_index << std::endl;
+			ok = false;
+		} else {
+			ok = write_query_index(f, words, virtual_stems, affixes);
+			f.close();
+			if (ok && !f) {
+				std::cerr << "couldn't write query index file: " << opt.query_index << std::endl;
+				ok = false;
+			}
+			if (!ok) {
+				// Don't leave a truncated index behind.
+				std::remove(opt.query_index.c_str());
+			}
+		}
+		MemoryReport::print(std::cerr, "writing the query index");
+	}
+
+	if (opt.verify) {
+		Trace::Span span("verify");
+		Verifier v(words, word_set, virtual_stems, affixes);
+		v.run();
+		v.print(std::cerr);
+	}
+
+	if (opt.print_stats) {
+		if (Alphabet::isEnabled()) {
+			stats.alphabet = Alphabet::size();
+		}
+		stats.print(std::cerr);
+	}
+	return ok;
+}
+
+
+/* Engine comparison */
+
+namespace {
+	// What the output says about a word: its stem type and the words
+	// derived from it by every group it is a stem of.
+	struct OutputEntry {
+		char type;
+		std::map<String, std::set<String> > derived;
+	};
+
+	typedef std::map<String, OutputEntry> OutputMap;
+
+	void describe(WordList& words, WordList& vstems, OutputMap& m) {
+		std::vector<Word*> list;
+		collect_output(words, vstems, list);
+		for (auto w : list) {
+			OutputEntry& e = m[Alphabet::decode(w->getWord())];
+			e.type = w->isStem() ? static_cast<char>(w->getStemType()) : ' ';
+			for (auto g : w->getStemOf()) {
+				auto& d = e.derived[g->getName()];
+				for (auto& a : w->getAffixesByGroup(*g)) {
+					if (!a.word.isStem()) {
+						d.insert(Alphabet::decode(a.word.getWord()));
+					}
+				}
+			}
+		}
+	}
+
+	// Returns the first key of a not in b, or of b not in a. Sets in_a to
+	// tell which one it is.
+	template <typename T>
+	bool first_difference(const T& a, const T& b, typename T::key_type& key, bool& in_a) {
+		auto i = a.begin();
+		auto j = b.begin();
+		while (i != a.end() || j != b.end()) {
+			if (j == b.end() || (i != a.end() && *i < *j)) {
+				key = *i;
+				in_a = true;
+				return true;
+			}
+			if (i == a.end() || *j < *i) {
+				key = *j;
+				in_a = false;
+				return true;
+			}
+			++i;
+			++j;
+		}
+		return false;
+	}
+
+	template <typename K, typename V>
+	bool first_difference(const std::map<K, V>& a, const std::map<K, V>& b, K& key, bool& in_a) {
+		std::set<K> ka, kb;
+		for (auto& e : a) {
+			ka.insert(e.first);
+		}
+		for (auto& e : b) {
+			kb.insert(e.first);
+		}
+		return first_difference(ka, kb, key, in_a);
+	}
+
+	const char* engine_name(Engine e) {
+		return e == Engine::REFERENCE ? "reference" : "optimized";
+	}
+}
+
+bool Munch::compare(Munch& a, Munch& b, std::ostream& out) {
+	OutputMap ma, mb;
+	describe(a.words, a.virtual_stems, ma);
+	describe(b.words, b.virtual_stems, mb);
+
+	const char* na = engine_name(a.opt.engine);
+	const char* nb = engine_name(b.opt.engine);
+
+	String word;
+	bool in_a;
+	if (first_difference(ma, mb, word, in_a)) {
+		out << "engines differ: word " << word << " is only written by the "
+			<< (in_a ? na : nb) << " engine" << std::endl;
+		return false;
+	}
+
+	for (auto& e : ma) {
+		OutputEntry& ea = e.second;
+		OutputEntry& eb = mb.at(e.first);
+
+		String group;
+		if (first_difference(ea.derived, eb.derived, group, in_a)) {
+			out << "engines differ: stem " << e.first << ", group " << group
+				<< " is only confirmed by the " << (in_a ? na : nb) << " engine" << std::endl;
+			return false;
+		}
+
+		for (auto& g : ea.derived) {
+			String derived;
+			if (first_difference(g.second, eb.derived.at(g.first), derived, in_a)) {
+				out << "engines differ: stem " << e.first << ", group " << g.first
+					<< ", derived word " << derived << " is only found by the "
+					<< (in_a ? na : nb) << " engine" << std::endl;
+				return false;
+			}
+		}
+
+		if (ea.type != eb.type) {
+			out << "engines differ: stem " << e.first << " has type '" << ea.type
+				<< "' (" << na << ") and '" << eb.type << "' (" << nb << ")" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,118 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_MUNCH_H_
+#define _XMUNCH_MUNCH_H_
+
+#include "xmunch.h"
+#include "word.h"
+#include "affix.h"
+#include "stats.h"
+#include "output.h"
+#include "match-context.h"
+#include "word-set.h"
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace xmunch {
+
+	struct Options {
+		bool print_tree = false;
+		bool no_compression = false;
+		bool verify = false;
+		bool print_stats = false;
+		size_t max_candidates = 0;
+		SortOrder sort_order = SortOrder::NONE;
+		Engine engine = Engine::OPTIMIZED;
+		bool global_resolver = false;
+		WordSetType word_set = WordSetType::HASH;
+		bool drop_empty = false;
+		bool drop_comments = false;
+		String query_index; // File to write the query index to
+	};
+
+	/**
+	 * One xmunch run: the word list, the affix groups and the stems found
+	 * by matching them.
+	 */
+	class Munch {
+		const Options& opt;
+
+		WordList words;
+		Index index;
+		WordSet word_set;
+
+		WordList virtual_stems;
+		Index virtual_index;
+
+		AffixGroupList affixes;
+
+		// With --variants, the words of every word list in input order.
+		std::vector<std::vector<Word*> > variant_words;
+
+		Stats stats;
+
+		public:
+			Munch(const Options& o)
+				: opt(o), word_set(index), virtual_stems(MemoryTag::VIRTUAL), virtual_index(MemoryTag::VIRTUAL) {};
+
+			Munch(const Munch&) = delete;
+			Munch& operator=(const Munch&) = delete;
+
+			// Read the word list, the affix definitions and the optional
+			// premunched data.
+			void load(std::istream& in, std::istream& aff, std::istream* pm);
+
+			// Read several word lists into one, the i-th one is variant i.
+			// Words in more than one list are kept once.
+			void loadVariants(const std::vector<std::istream*>& in, std::istream& aff);
+
+			void match();
+
+			// Match the words of all variants at once, then confirm the
+			// stems of each variant and write its result to out[i].
+			void matchVariants(const std::vector<std::ostream*>& out);
+
+			// Write the result and, if requested, the query index, the
+			// verification summary and statistics. Returns false if the
+			// query index couldn't be written.
+			bool write(std::ostream& out);
+
+			// Compare the results of two runs. Prints the first difference
+			// to out and returns false if there is one.
+			static bool compare(Munch& a, Munch& b, std::ostream& out);
+
+		protected:
+			void loadWords(std::istream& in, size_t variant, std::vector<Word*>* order = nullptr);
+
+			// Parse the affixes, read the premunched data and build the
+			// word set.
+			void prepare(std::istream& aff, std::istream* pm);
+
+			// Build the sorted index for the optimized engine.
+			void startMatching(SortedIndex& sorted);
+
+			// Write the words of variant (all words if 0), with the
+			// virtual stems of vstems.
+			void writeWords(std::ostream& out, WordList& vstems, VariantSet variant);
+	};
+}
+
+#endif /* ifndef _XMUNCH_MUNCH_H_ */
@@ -0,0 +1,283 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "output.h"
+
+#include "word.h"
+#include "alphabet.h"
+#include "parallel-sort.h"
+#include "query-index.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <locale>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+using namespace xmunch;
+
+void xmunch::collect_output(WordList& words, WordList& vstems, std::vector<Word*>& list, VariantSet variant) {
+	for (auto& w : words) {
+		if (variant != 0 && !w.inVariant(variant)) {
+			if (w.isStem()) {
+				list.push_back(&w);
+			}
+		} else if (!w.hasStem()) {
+			list.push_back(&w);
+		}
+	}
+	for (auto& w : vstems) {
+		if (w.isStem()) {
+			list.push_back(&w);
+		}
+	}
+}
+
+void xmunch::sort_output(std::vector<Word*>& list, SortOrder order) {
+	if (order == SortOrder::NONE) {
+		return;
+	}
+
+	std::locale loc = std::locale::classic();
+	if (order == SortOrder::LOCALE) {
+		try {
+			loc = std::locale("");
+		} catch (std::runtime_error& e) {
+			std::cerr << "WARNING, couldn't load the locale set in the environment, "
+				<< "sorting bytewise." << std::endl;
+			order = SortOrder::BYTEWISE;
+		}
+	}
+
+	// Compute the sort key of every word once, so comparing is a plain
+	// byte compare: the output line (word, separator and affix marks), or
+	// its collation key. Like sort, the key ends before the newline.
+	typedef std::pair<String, Word*> Entry;
+	std::vector<Entry> keys(list.size());
+
+	size_t threads = worker_count();
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+		workers.emplace_back([&, t] () {
+				Trace::Span span("sort keys");
+				const std::collate<Char>& col = std::use_facet<std::collate<Char> >(loc);
+				std::ostringstream line;
+				for (size_t i = list.size() * t / threads; i < list.size() * (t + 1) / threads; i++) {
+					line.str("");
+					list[i]->format(line);
+					String w = line.str();
+					w.pop_back();
+					if (order == SortOrder::LOCALE) {
+						w = col.transform(w.data(), w.data() + w.length());
+					}
+					keys[i] = Entry(std::move(w), list[i]);
+				}
+			});
+	}
+	for (auto& t : workers) {
+		t.join();
+	}
+
+	// Compares as unsigned char, like sort does.
+	parallel_sort(keys.begin(), keys.end(), [] (const Entry& a, const Entry& b) {
+			return a.first < b.first;
+		}, threads);
+
+	for (size_t i = 0; i < keys.size(); i++) {
+		list[i] = keys[i].second;
+	}
+}
+
+namespace {
+	typedef std::vector<Word*>::const_iterator OutputIterator;
+
+	void format_range(std::ostream& out, OutputIterator begin, OutputIterator end, bool no_compression) {
+		for (auto i = begin; i != end; ++i) {
+			if (no_compression) {
+				(*i)->format_uncompressed(out);
+			} else {
+				(*i)->format(out);
+			}
+		}
+	}
+}
+
+void xmunch::write_output(std::ostream& out, const std::vector<Word*>& list, bool no_compression, size_t threads) {
+	if (threads < 2 || list.size() < 4096) {
+		format_range(out, list.begin(), list.end(), no_compression);
+		return;
+	}
+
+	// The workers format chunks into their own buffers, this thread writes
+	// them in order as soon as they are ready. More chunks than threads, so
+	// writing can start early and uneven chunks even out.
+	size_t chunks = threads * 8;
+	std::vector<String> buffers(chunks);
+	std::vector<char> ready(chunks, 0);
+	std::atomic<size_t> next(0);
+	std::mutex m;
+	std::condition_variable cv;
+
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+		workers.emplace_back([&] () {
+				size_t c;
+				while ((c = next++) < chunks) {
+					Trace::Span span("format chunk");
+					std::ostringstream s;
+					format_range(s,
+							list.begin() + list.size() * c / chunks,
+							list.begin() + list.size() * (c + 1) / chunks,
+							no_compression);
+					{
+						std::lock_guard<std::mutex> l(m);
+						buffers[c] = s.str();
+						ready[c] = 1;
+					}
+					cv.notify_all();
+				}
+			});
+	}
+
+	for (size_t c = 0; c < chunks; c++) {
+		String b;
+		{
+			std::unique_lock<std::mutex> l(m);
+			cv.wait(l, [&] () { return ready[c] != 0; });
+			b.swap(buffers[c]);
+		}
+		out.write(b.data(), b.size());
+	}
+
+	for (auto& t : workers) {
+		t.join();
+	}
+}
+
+bool xmunch::write_query_index(std::ostream& out, WordList& words, WordList& vstems, AffixGroupList& groups) {
+	using namespace query_index;
+
+	// Every word and group name is stored once.
+	String strings;
+	std::unordered_map<const Word*, Text> texts;
+	auto add_text = [&strings] (const String& s) {
+		Text t = {static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(s.size())};
+		strings += s;
+		return t;
+	};
+	auto text_of = [&] (const Word& w) {
+		auto i = texts.find(&w);
+		if (i == texts.end()) {
+			i = texts.emplace(&w, add_text(Alphabet::decode(w.getWord()))).first;
+		}
+		return i->second;
+	};
+
+	std::unordered_map<const AffixGroup*, std::uint32_t> group_ids;
+	std::vector<Text> names;
+	for (auto& g : groups) {
+		group_ids.emplace(&g, names.size());
+		names.push_back(add_text(g.getName()));
+	}
+
+	std::vector<Entry> entries;
+	auto add = [&] (const Word& form, const Word& stem, std::uint32_t group) {
+		Entry e = Entry();
+		e.form = text_of(form);
+		e.stem = text_of(stem);
+		e.group = group;
+		e.stem_type = static_cast<char>(stem.getStemType());
+		entries.push_back(e);
+	};
+	// The same as written with --no-compression.
+	auto add_derived = [&] (Word& stem) {
+		for (auto g : stem.getStemOf()) {
+			for (auto& a : stem.getAffixesByGroup(*g)) {
+				if (!a.word.isStem()) {
+					add(a.word, stem, group_ids.at(g));
+				}
+			}
+		}
+	};
+	{
+		Trace::Span span("collect query entries");
+		for (auto& w : words) {
+			if (!w.hasStem()) {
+				add(w, w, NO_GROUP);
+			}
+			add_derived(w);
+		}
+		for (auto& w : vstems) {
+			// Created stems are words of the result, virtual ones aren't.
+			StemType t = w.getStemType();
+			if (w.isStem() && t != StemType::VIRTUAL && t != StemType::OPTIONAL) {
+				add(w, w, NO_GROUP);
+			}
+			add_derived(w);
+		}
+	}
+
+	if (strings.size() > std::numeric_limits<std::uint32_t>::max() ||
+			entries.size() > std::numeric_limits<std::uint32_t>::max()) {
+		std::cerr << "the result is too large for a query index." << std::endl;
+		return false;
+	}
+
+	{
+		Trace::Span span("sort query entries");
+		auto compare = [&strings] (const Text& a, const Text& b) {
+			int c = std::memcmp(strings.data() + a.offset, strings.data() + b.offset, std::min(a.length, b.length));
+			if (c != 0) {
+				return c;
+			}
+			return a.length < b.length ? -1 : (a.length > b.length ? 1 : 0);
+		};
+		parallel_sort(entries.begin(), entries.end(), [&compare] (const Entry& a, const Entry& b) {
+				int c = compare(a.form, b.form);
+				if (c == 0) {
+					c = compare(a.stem, b.stem);
+				}
+				return c < 0 || (c == 0 && a.group < b.group);
+			});
+		// Two affixes of a group might derive the same word from a stem.
+		entries.erase(std::unique(entries.begin(), entries.end(), [] (const Entry& a, const Entry& b) {
+				return a.form.offset == b.form.offset && a.stem.offset == b.stem.offset && a.group == b.group;
+			}), entries.end());
+	}
+
+	Header h = Header();
+	std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+	h.version = VERSION;
+	h.byte_order = ORDER_MARK;
+	h.entries = entries.size();
+	h.groups = names.size();
+	h.strings = strings.size();
+
+	Trace::Span span("write query index");
+	out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+	out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+	out.write(reinterpret_cast<const char*>(names.data()), names.size() * sizeof(Text));
+	out.write(strings.data(), strings.size());
+	return true;
+}
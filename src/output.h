@@ -0,0 +1,57 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_OUTPUT_H_
+#define _XMUNCH_OUTPUT_H_
+
+#include "xmunch.h"
+#include "parallel-sort.h"
+
+#include <vector>
+#include <ostream>
+
+namespace xmunch {
+
+	enum class SortOrder : char {
+		NONE,
+		BYTEWISE, // By the (decoded) bytes of the words, like LC_ALL=C sort
+		LOCALE // By the collation of the current locale
+	};
+
+	// Collect the words to print: words not derived from a stem and all
+	// confirmed virtual stems. If variant is set, only the words of this
+	// variant, the stems among the other words are virtual ones there.
+	void collect_output(WordList& words, WordList& vstems, std::vector<Word*>& list, VariantSet variant = 0);
+
+	void sort_output(std::vector<Word*>& list, SortOrder order);
+
+	// Formats the words on worker threads, writes them in the order of list.
+	void write_output(
+			std::ostream& out,
+			const std::vector<Word*>& list,
+			bool no_compression,
+			size_t threads = worker_count()
+		);
+
+	// Write the table of query-index.h, from every word to the stems and
+	// groups of the result it is derived from. Returns false if it is too
+	// large for the format.
+	bool write_query_index(std::ostream& out, WordList& words, WordList& vstems, AffixGroupList& groups);
+}
+
+#endif /* ifndef _XMUNCH_OUTPUT_H_ */
@@ -0,0 +1,87 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_PARALLEL_SORT_H_
+#define _XMUNCH_PARALLEL_SORT_H_
+
+#include "trace.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace xmunch {
+
+	inline size_t worker_count() {
+		size_t n = std::thread::hardware_concurrency();
+		return n == 0 ? 1 : n;
+	}
+
+	/**
+	 * Stable sort of [begin, end): chunks are sorted on their own threads
+	 * and then merged pairwise, again in parallel.
+	 */
+	template<class It, class Compare>
+	void parallel_sort(It begin, It end, Compare comp, size_t threads = worker_count()) {
+		size_t n = end - begin;
+		if (threads < 2 || n < 4096) {
+			std::stable_sort(begin, end, comp);
+			return;
+		}
+
+		std::vector<It> bounds;
+		for (size_t i = 0; i < threads; i++) {
+			bounds.push_back(begin + n * i / threads);
+		}
+		bounds.push_back(end);
+
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i + 1 < bounds.size(); i++) {
+			workers.emplace_back([&bounds, &comp, i] () {
+					Trace::Span span("sort chunk");
+					std::stable_sort(bounds[i], bounds[i + 1], comp);
+				});
+		}
+		for (auto& t : workers) {
+			t.join();
+		}
+
+		while (bounds.size() > 2) {
+			std::vector<It> merged;
+			workers.clear();
+			for (size_t i = 0; i + 2 < bounds.size(); i += 2) {
+				workers.emplace_back([&bounds, &comp, i] () {
+						Trace::Span span("merge chunks");
+						std::inplace_merge(bounds[i], bounds[i + 1], bounds[i + 2], comp);
+					});
+				merged.push_back(bounds[i]);
+			}
+			if (bounds.size() % 2 == 0) {
+				// Odd number of chunks, the last one waits for the next round.
+				merged.push_back(bounds[bounds.size() - 2]);
+			}
+			merged.push_back(end);
+			for (auto& t : workers) {
+				t.join();
+			}
+			bounds.swap(merged);
+		}
+	}
+}
+
+#endif /* ifndef _XMUNCH_PARALLEL_SORT_H_ */
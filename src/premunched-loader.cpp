@@ -20,6 +20,7 @@
 
 #include "word.h"
 #include "affix.h"
+#include "alphabet.h"
 
 #include <iostream>
 #include <algorithm>
@@ -28,14 +29,15 @@
 using namespace xmunch;
 
 PremunchedLoader::PremunchedLoader(
-					std::ifstream& input,
+					std::istream& input,
 					AffixGroupList& a,
 					WordList& w,
 					Index& wi,
 					WordList& virtual_w,
 					Index& virtual_wi
 				):
-src(input), words(w), index(wi), vwords(virtual_w), vindex(virtual_wi), affixes(a) {}
+src(input), words(w), index(wi), vwords(virtual_w), vindex(virtual_wi), affixes(a),
+	id_counter(wi.size()) {}
 
 PremunchedLoader::~PremunchedLoader() {}
 
@@ -55,14 +57,15 @@ void  PremunchedLoader::load() {
 
 		if (c != ';') {
 			std::cerr << "Error in premunched input, expected ';' got '" <<
-				c << "' near '" << w->getWord() << "'" << std::endl;
+				c << "' near '" << Alphabet::decode(w->getWord()) << "'" << std::endl;
 		}
 		skipWhite();
 	}
 }
 
 Word* PremunchedLoader::loadWord() {
-	String s = readWord();
+	String raw = readWord();
+	String s = Alphabet::encode(raw);
 
 	bool virt = false;
 	StemType type = StemType::NORMAL;
@@ -87,7 +90,7 @@ Word* PremunchedLoader::loadWord() {
 				type = StemType::NORMAL;
 				break;
 			default:
-				std::cerr << "Error in premunched input, expected @v, @o or @c near '" << s << "'" << std::endl;
+				std::cerr << "Error in premunched input, expected @v, @o or @c near '" << raw << "'" << std::endl;
 
 		}
 	}
@@ -125,6 +128,7 @@ Word* PremunchedLoader::loadWord() {
 		} else {
 			words.emplace_front(s);
 			ret = &(*words.begin());
+			ret->setId(id_counter++);
 			index.emplace(ret->getWord(), *ret);
 		}
 	}
@@ -136,12 +140,16 @@ Word* PremunchedLoader::loadWord() {
 
 String PremunchedLoader::readWord() {
 	String ret("");
-	Char c = 0;
 
 	while (src && !src.eof()) {
-		c = src.peek();
+		std::istream::int_type i = src.peek();
+		if (i == std::istream::traits_type::eof()) {
+			break;
+		}
 
-		if (c < 31 /* control chars */ ||
+		// As unsigned char, bytes of UTF-8 sequences are word characters.
+		Char c = std::istream::traits_type::to_char_type(i);
+		if (static_cast<unsigned char>(c) < 31 /* control chars */ ||
 				c == ' ' || c == '#' ||
 				c == ';' || c == ',' ||
 				c == '@' || c == ':' ||
@@ -187,11 +195,12 @@ void PremunchedLoader::loadDerivedList(Word& stem) {
 
 		skipWhite();
 		while (src && !src.eof() && src.peek() != '}') {
-			String w = readWord();
+			String w = Alphabet::encode(readWord());
 			Word* derived;
 			if (index.count(w) == 0) {
 				words.emplace_front(w);
 				derived = &*words.begin();
+				derived->setId(id_counter++);
 				index.emplace(derived->getWord(), *derived);
 			} else {
 				derived = &index.at(w);
@@ -21,11 +21,11 @@
 
 #include "xmunch.h"
 
-#include <fstream>
+#include <istream>
 
 namespace xmunch {
 	class PremunchedLoader {
-		std::ifstream& src;
+		std::istream& src;
 
 		WordList& words;
 		Index& index;
@@ -35,12 +35,13 @@ namespace xmunch {
 
 		AffixGroupList& affixes;
 
-		int id_counter;
+		// Ids of words which aren't in the word list continue after it.
+		size_t id_counter;
 
 		public:
 
 			PremunchedLoader(
-					std::ifstream& input,
+					std::istream& input,
 					AffixGroupList& a,
 					WordList& w,
 					Index& wi,
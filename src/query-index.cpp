@@ -0,0 +1,151 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "query-index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace xmunch;
+using namespace xmunch::query_index;
+
+namespace {
+	// Whether t lies inside a string table of size bytes.
+	bool in_strings(const query_index::Text& t, std::uint64_t size) {
+		return t.offset <= size && t.length <= size - t.offset;
+	}
+}
+
+bool QueryIndex::open(const std::string& file) {
+	close();
+
+	int fd = ::open(file.c_str(), O_RDONLY);
+	if (fd < 0) {
+		std::cerr << "couldn't open query index: " << file << std::endl;
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+		std::cerr << "not a query index: " << file << std::endl;
+		::close(fd);
+		return false;
+	}
+	size = st.st_size;
+	data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED) {
+		std::cerr << "couldn't map query index: " << file << std::endl;
+		data = nullptr;
+		return false;
+	}
+
+	header = static_cast<const Header*>(data);
+	if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION) {
+		std::cerr << "not a query index of this version: " << file << std::endl;
+		close();
+		return false;
+	}
+	if (header->byte_order != ORDER_MARK) {
+		std::cerr << "query index written on a machine with another byte order: " << file << std::endl;
+		close();
+		return false;
+	}
+	size_t tables = sizeof(Header) + size_t(header->entries) * sizeof(Entry)
+		+ size_t(header->groups) * sizeof(query_index::Text);
+	if (tables > size || header->strings != size - tables) {
+		std::cerr << "truncated query index: " << file << std::endl;
+		close();
+		return false;
+	}
+
+	const char* p = static_cast<const char*>(data) + sizeof(Header);
+	entries = reinterpret_cast<const Entry*>(p);
+	p += header->entries * sizeof(Entry);
+	groups = reinterpret_cast<const query_index::Text*>(p);
+	p += header->groups * sizeof(query_index::Text);
+	strings = p;
+
+	// Lookups use the offsets and group numbers as they are, a damaged
+	// file must not make them read outside of the mapping.
+	bool valid = true;
+	for (size_t i = 0; i < header->groups && valid; i++) {
+		valid = in_strings(groups[i], header->strings);
+	}
+	for (size_t i = 0; i < header->entries && valid; i++) {
+		const Entry& e = entries[i];
+		valid = in_strings(e.form, header->strings) && in_strings(e.stem, header->strings) &&
+			(e.group == NO_GROUP || e.group < header->groups);
+	}
+	if (!valid) {
+		std::cerr << "damaged query index: " << file << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void QueryIndex::close() {
+	if (data != nullptr) {
+		munmap(data, size);
+	}
+	data = nullptr;
+	size = 0;
+	header = nullptr;
+	entries = nullptr;
+	groups = nullptr;
+	strings = nullptr;
+}
+
+QueryIndex::Range QueryIndex::find(const char* form, size_t length) const {
+	if (header == nullptr) {
+		return Range(nullptr, nullptr);
+	}
+
+	// Bytewise, like the entries were sorted.
+	auto compare = [&] (const Entry& e) {
+		int c = std::memcmp(strings + e.form.offset, form, std::min<size_t>(e.form.length, length));
+		if (c != 0) {
+			return c;
+		}
+		return e.form.length < length ? -1 : (e.form.length > length ? 1 : 0);
+	};
+	const Entry* end = entries + header->entries;
+	const Entry* b = std::partition_point(entries, end, [&] (const Entry& e) { return compare(e) < 0; });
+	const Entry* e = b;
+	while (e != end && compare(*e) == 0) {
+		++e;
+	}
+	return Range(b, e);
+}
+
+QueryIndex::Text QueryIndex::getGroup(const Entry& e) const {
+	if (e.group == NO_GROUP) {
+		return {strings, 0};
+	}
+	return text(groups[e.group]);
+}
+
+std::ostream& xmunch::operator<<(std::ostream& out, const QueryIndex::Text& t) {
+	return out.write(t.data, t.length);
+}
@@ -0,0 +1,128 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_QUERY_INDEX_H_
+#define _XMUNCH_QUERY_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+
+namespace xmunch {
+
+	/**
+	 * A binary table from every word of the word list to the stems and
+	 * affix groups it is derived from, written with --query-index and
+	 * read in place through mmap. Layout, in the byte order of the
+	 * writing machine:
+	 *
+	 *   Header
+	 *   Entry[entries], sorted by form (bytewise), then stem and group
+	 *   Text[groups], the names of the affix groups
+	 *   char[strings], the words and group names
+	 *
+	 * A word of the result which isn't derived from a stem (or is a stem
+	 * itself) has one entry with itself as stem and no group. Virtual
+	 * stems are only found as stems.
+	 */
+	namespace query_index {
+		const char MAGIC[8] = {'X', 'M', 'Q', 'I', 'D', 'X', '\0', '\0'};
+		const std::uint32_t VERSION = 1;
+		const std::uint32_t ORDER_MARK = 0x01020304;
+		const std::uint32_t NO_GROUP = 0xffffffff;
+
+		struct Header {
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t byte_order;
+			std::uint32_t entries;
+			std::uint32_t groups;
+			std::uint64_t strings; // Size in bytes
+		};
+
+		// A string of the string table.
+		struct Text {
+			std::uint32_t offset;
+			std::uint32_t length;
+		};
+
+		struct Entry {
+			Text form;
+			Text stem;
+			std::uint32_t group; // Index of the group name, or NO_GROUP
+			char stem_type; // As StemType, 'v' and 'o' are virtual stems
+			char reserved[3];
+		};
+	}
+
+	/**
+	 * Read only view of a query index file.
+	 */
+	class QueryIndex {
+		void* data;
+		size_t size;
+
+		const query_index::Header* header;
+		const query_index::Entry* entries;
+		const query_index::Text* groups;
+		const char* strings;
+
+		public:
+			// A string inside the mapped file.
+			struct Text {
+				const char* data;
+				size_t length;
+
+				std::string str() const { return std::string(data, length); }
+			};
+
+			typedef std::pair<const query_index::Entry*, const query_index::Entry*> Range;
+
+			QueryIndex() : data(nullptr), size(0), header(nullptr), entries(nullptr), groups(nullptr), strings(nullptr) {}
+			~QueryIndex() { close(); }
+
+			QueryIndex(const QueryIndex&) = delete;
+			QueryIndex& operator=(const QueryIndex&) = delete;
+
+			// Map file and check that all entries point into it. Prints the
+			// reason to std::cerr and returns false if it isn't a valid
+			// query index.
+			bool open(const std::string& file);
+			void close();
+
+			size_t entryCount() const { return header ? header->entries : 0; }
+
+			// The entries of form, empty if it isn't in the word list.
+			Range find(const char* form, size_t length) const;
+			Range find(const std::string& form) const { return find(form.data(), form.length()); }
+
+			Text getForm(const query_index::Entry& e) const { return text(e.form); }
+			Text getStem(const query_index::Entry& e) const { return text(e.stem); }
+			// Empty for the entry of a word as its own stem.
+			Text getGroup(const query_index::Entry& e) const;
+
+		protected:
+			Text text(const query_index::Text& t) const { return {strings + t.offset, t.length}; }
+	};
+
+	std::ostream& operator<<(std::ostream& out, const QueryIndex::Text& t);
+}
+
+#endif /* ifndef _XMUNCH_QUERY_INDEX_H_ */
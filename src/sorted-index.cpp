@@ -0,0 +1,75 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "sorted-index.h"
+
+#include "word.h"
+
+#include <algorithm>
+
+using namespace xmunch;
+
+// Compare a with b bytewise, reading both backwards if reverse is set. If
+// truncate is set, only the first b.length() bytes of a are used, so every
+// a starting (ending) with b compares equal.
+static int compare_bytes(const String& a, const String& b, bool reverse, bool truncate = false) {
+	size_t l = std::min(a.length(), b.length());
+	for (size_t i = 0; i < l; i++) {
+		unsigned char ca = a[reverse ? a.length() - 1 - i : i];
+		unsigned char cb = b[reverse ? b.length() - 1 - i : i];
+		if (ca != cb) {
+			return ca < cb ? -1 : 1;
+		}
+	}
+	if (a.length() < b.length()) {
+		return -1;
+	}
+	return a.length() == b.length() || truncate ? 0 : 1;
+}
+
+void SortedIndex::build(const WordSet::List& words) {
+	by_prefix.assign(words.begin(), words.end());
+	by_suffix = by_prefix;
+
+	std::sort(by_prefix.begin(), by_prefix.end(), [] (Word* a, Word* b) {
+			return compare_bytes(a->getWord(), b->getWord(), false) < 0;
+		});
+	std::sort(by_suffix.begin(), by_suffix.end(), [] (Word* a, Word* b) {
+			return compare_bytes(a->getWord(), b->getWord(), true) < 0;
+		});
+}
+
+static SortedIndex::Range affix_range(const std::vector<Word*>& v, const String& a, bool reverse) {
+	auto lower = std::lower_bound(v.begin(), v.end(), a,
+			[reverse] (const Word* w, const String& s) {
+				return compare_bytes(w->getWord(), s, reverse, true) < 0;
+			});
+	auto upper = std::upper_bound(lower, v.end(), a,
+			[reverse] (const String& s, const Word* w) {
+				return compare_bytes(w->getWord(), s, reverse, true) > 0;
+			});
+	return SortedIndex::Range(lower, upper);
+}
+
+SortedIndex::Range SortedIndex::withSuffix(const String& suffix) const {
+	return affix_range(by_suffix, suffix, true);
+}
+
+SortedIndex::Range SortedIndex::withPrefix(const String& prefix) const {
+	return affix_range(by_prefix, prefix, false);
+}
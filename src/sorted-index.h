@@ -0,0 +1,54 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_SORTED_INDEX_H_
+#define _XMUNCH_SORTED_INDEX_H_
+
+#include "xmunch.h"
+#include "word-set.h"
+
+#include <vector>
+#include <utility>
+
+namespace xmunch {
+
+	/**
+	 * All indexed words, once sorted by their reversed string and once by
+	 * the string itself. All words with a given suffix (prefix) form a
+	 * contiguous range, which allows affixes to visit only the words they
+	 * can match.
+	 */
+	class SortedIndex {
+		std::vector<Word*> by_suffix;
+		std::vector<Word*> by_prefix;
+
+		public:
+			typedef std::vector<Word*>::const_iterator Iterator;
+			typedef std::pair<Iterator, Iterator> Range;
+
+			void build(const WordSet::List& words);
+
+			size_t size() const { return by_prefix.size(); }
+
+			Range all() const { return Range(by_prefix.begin(), by_prefix.end()); }
+			Range withSuffix(const String& suffix) const;
+			Range withPrefix(const String& prefix) const;
+	};
+}
+
+#endif /* ifndef _XMUNCH_SORTED_INDEX_H_ */
@@ -0,0 +1,59 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "stats.h"
+
+using namespace xmunch;
+
+static double percent(size_t part, size_t total) {
+	return total == 0 ? 0.0 : 100.0 * part / total;
+}
+
+void Stats::print(std::ostream& out) const {
+	out << "words: " << words << "\n"
+		<< "word list lines: " << input_lines << ", " << trimmed_lines
+			<< " trimmed, " << duplicate_lines << " duplicates, "
+			<< dropped_lines << " dropped\n";
+	for (size_t i = 0; i < variants.size(); i++) {
+		const Variant& v = variants[i];
+		out << "variant " << i + 1 << ": " << v.words << " words, "
+			<< v.shared_lines << " in an earlier list, " << v.stems << " stems, "
+			<< v.virtual_stems << " virtual stems\n";
+	}
+	if (alphabet != 0) {
+		out << "alphabet: " << alphabet << " characters\n";
+	}
+	if (dawg_states != 0) {
+		out << "word automaton: " << dawg_states << " states, "
+			<< dawg_transitions << " transitions\n";
+	}
+	out
+		<< "virtual stems: " << virtual_stems << " confirmed of "
+			<< virtual_candidates << " candidates, " << virtual_capped
+			<< " candidates over the limit\n"
+		<< "stem probes: " << stem_probes << "\n";
+
+	size_t absent = filter_rejects + filter_false_positives;
+	out << "bloom filter: " << absent << " absent stems ("
+			<< percent(absent, stem_probes) << "% of lookups), "
+			<< filter_rejects << " rejected, "
+			<< filter_false_positives << " false positives ("
+			<< percent(filter_false_positives, absent) << "%)\n"
+		<< "stem driven groups: " << forward_groups << ", "
+			<< forward_probes << " form lookups" << std::endl;
+}
@@ -0,0 +1,71 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_STATS_H_
+#define _XMUNCH_STATS_H_
+
+#include "xmunch.h"
+
+#include <ostream>
+#include <vector>
+
+namespace xmunch {
+
+	/**
+	 * Counters collected during a run, printed with --stats.
+	 */
+	struct Stats {
+		// The result of one word list of --variants.
+		struct Variant {
+			size_t words = 0;
+			size_t stems = 0;
+			size_t virtual_stems = 0;
+			size_t shared_lines = 0; // Words read before from another list
+		};
+
+		size_t words = 0;
+		size_t input_lines = 0; // Of the word list
+		size_t trimmed_lines = 0;
+		size_t duplicate_lines = 0;
+		size_t dropped_lines = 0; // Empty and comment lines
+		size_t alphabet = 0; // Characters used, with --remap-alphabet
+		size_t dawg_states = 0; // With --word-set=dawg
+		size_t dawg_transitions = 0;
+		size_t virtual_stems = 0; // Confirmed ones
+		size_t virtual_candidates = 0;
+		size_t virtual_capped = 0; // Not created due to --max-candidates
+
+		size_t stem_probes = 0;
+
+		// Probes rejected by the bloom filter and the ones which passed
+		// it without being found.
+		size_t filter_rejects = 0;
+		size_t filter_false_positives = 0;
+
+		// Groups matched by generating forms of their stems, and the word
+		// list lookups of these forms.
+		size_t forward_groups = 0;
+		size_t forward_probes = 0;
+
+		std::vector<Variant> variants;
+
+		void print(std::ostream& out) const;
+	};
+}
+
+#endif /* ifndef _XMUNCH_STATS_H_ */
@@ -0,0 +1,116 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "stem-condition.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace xmunch;
+
+void StemCondition::compile(const StringList& alts, bool suf) {
+	suffix = suf;
+	nodes.clear();
+	edges.clear();
+	next_bytes.reset();
+	alternatives = alts;
+	single_bytes = true;
+	for (auto& a : alts) {
+		if (a.empty()) {
+			alternatives.clear();
+			return; // Every stem fulfills it.
+		}
+		next_bytes.set(static_cast<unsigned char>(suffix ? a.back() : a.front()));
+		single_bytes = single_bytes && a.length() == 1;
+	}
+	if (alts.empty()) {
+		return;
+	}
+
+	// Build the trie with maps, read from the affix outwards, then store
+	// it breadth first with sorted edges.
+	std::vector<std::map<unsigned char, uint32_t> > children(1);
+	std::vector<bool> accept(1, false);
+	for (auto& a : alts) {
+		uint32_t n = 0;
+		for (size_t i = 0; i < a.length(); i++) {
+			unsigned char c = a[suffix ? a.length() - 1 - i : i];
+			auto e = children[n].find(c);
+			if (e == children[n].end()) {
+				children.emplace_back();
+				accept.push_back(false);
+				e = children[n].emplace(c, children.size() - 1).first;
+			}
+			n = e->second;
+		}
+		accept[n] = true;
+	}
+
+	std::vector<uint32_t> order(1, 0);
+	std::vector<uint32_t> number(children.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		number[order[i]] = i;
+		for (auto& e : children[order[i]]) {
+			order.push_back(e.second);
+		}
+	}
+	for (auto n : order) {
+		nodes.push_back({static_cast<uint32_t>(edges.size()), accept[n]});
+		for (auto& e : children[n]) {
+			edges.emplace_back(e.first, number[e.second]);
+		}
+	}
+	nodes.push_back({static_cast<uint32_t>(edges.size()), false});
+}
+
+size_t StemCondition::walk(const String& s, size_t begin, size_t end) const {
+	uint32_t n = 0;
+	for (size_t i = 0; i < end - begin; i++) {
+		unsigned char c = s[suffix ? end - 1 - i : begin + i];
+		auto b = edges.begin() + nodes[n].first;
+		auto e = edges.begin() + nodes[n + 1].first;
+		auto t = std::lower_bound(b, e, std::make_pair(c, uint32_t(0)));
+		if (t == e || t->first != c) {
+			return NO_MATCH;
+		}
+		n = t->second;
+		if (nodes[n].accept) {
+			return i + 1;
+		}
+	}
+	return NO_MATCH;
+}
+
+StringList StemCondition::getMinimalAlternatives() const {
+	StringList m;
+	for (auto& a : alternatives) {
+		bool minimal = true;
+		for (auto& b : alternatives) {
+			if (b.length() < a.length() && (suffix ?
+					a.compare(a.length() - b.length(), b.length(), b) == 0 :
+					a.compare(0, b.length(), b) == 0)) {
+				minimal = false;
+				break;
+			}
+		}
+		if (minimal && std::find(m.begin(), m.end(), a) == m.end()) {
+			m.push_back(a);
+		}
+	}
+	return m;
+}
@@ -0,0 +1,91 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_STEM_CONDITION_H_
+#define _XMUNCH_STEM_CONDITION_H_
+
+#include "xmunch.h"
+
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+namespace xmunch {
+
+	/**
+	 * The alternatives of a . affix (like x,y in "x,y .a"), which the stem
+	 * has to end with (or begin with, for prefixes) next to the affix.
+	 * They are compiled into a trie read from the affix outwards, which is
+	 * an acyclic automaton of the alternatives. The bytes next to the affix
+	 * are kept in a table: if all alternatives are single bytes (with
+	 * --remap-alphabet, single characters), the table is the whole test.
+	 */
+	class StemCondition {
+		struct Node {
+			uint32_t first; // Edges of the node are [first, next node's first)
+			bool accept;
+		};
+
+		std::vector<Node> nodes;
+		std::vector<std::pair<unsigned char, uint32_t> > edges;
+		std::bitset<256> next_bytes;
+		bool single_bytes;
+		bool suffix;
+
+		StringList alternatives;
+
+		public:
+			static const size_t NO_MATCH = size_t(-1);
+
+			StemCondition() : single_bytes(false), suffix(true) {}
+
+			// An empty alternative means no condition.
+			void compile(const StringList& alts, bool suffix);
+
+			bool isSet() const { return !nodes.empty(); }
+
+			// The length of the shortest alternative which s[begin, end)
+			// ends with (for a suffix condition) or begins with, or NO_MATCH.
+			size_t match(const String& s, size_t begin, size_t end) const {
+				if (nodes.empty()) {
+					return 0;
+				}
+				if (begin == end) {
+					return NO_MATCH;
+				}
+				unsigned char c = suffix ? s[end - 1] : s[begin];
+				if (!next_bytes.test(c)) {
+					return NO_MATCH;
+				}
+				if (single_bytes) {
+					return 1;
+				}
+				return walk(s, begin, end);
+			}
+
+			// All alternatives, and the ones no other alternative is a
+			// part of, which are enough to find all stems fulfilling it.
+			const StringList& getAlternatives() const { return alternatives; }
+			StringList getMinimalAlternatives() const;
+
+		protected:
+			size_t walk(const String& s, size_t begin, size_t end) const;
+	};
+}
+
+#endif /* ifndef _XMUNCH_STEM_CONDITION_H_ */
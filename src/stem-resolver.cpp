@@ -0,0 +1,182 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "stem-resolver.h"
+#include "affix.h"
+#include "word.h"
+
+#include <algorithm>
+
+using namespace xmunch;
+
+StemResolver::StemResolver(AffixGroupList& g, const WordSet& w) : groups(g), edges(g.size()), words(w), variant(0) {
+	size_t r = 0;
+	for (auto& a : groups) {
+		ranks.emplace(&a, r++);
+	}
+}
+
+void StemResolver::addEdge(const AffixGroup& group, Word& stem, const Affix& affix, Word& derived) {
+	edges[ranks.at(&group)].push_back({&stem, &derived, &affix});
+}
+
+void StemResolver::resolve() {
+	variant = 0;
+	size_t r = 0;
+	for (auto& g : groups) {
+		resolveGroup(g, r++);
+	}
+}
+
+void StemResolver::resolve(VariantSet v) {
+	variant = v;
+	size_t r = 0;
+	for (auto& g : groups) {
+		resolveGroup(g, r++);
+	}
+	variant = 0;
+}
+
+bool StemResolver::inVariant(const Edge& e) const {
+	if (variant == 0) {
+		return true;
+	}
+	if (!e.derived->inVariant(variant)) {
+		return false;
+	}
+	if (e.stem->getVariants() == 0) {
+		return true; // A virtual stem candidate
+	}
+	if (e.stem->inVariant(variant)) {
+		return e.affix->getStemType() != StemType::VIRTUAL;
+	}
+	return e.affix->getStemType() != StemType::NORMAL;
+}
+
+bool StemResolver::precedes(const Candidate& a, const Candidate& b) {
+	if (a.total != b.total) {
+		return a.total > b.total;
+	}
+	if (a.stem->getWord().length() != b.stem->getWord().length()) {
+		return a.stem->getWord().length() < b.stem->getWord().length();
+	}
+	if (a.known != b.known) {
+		return a.known;
+	}
+	if (a.known) {
+		return a.stem->getId() < b.stem->getId();
+	}
+	return a.stem->getWord() < b.stem->getWord();
+}
+
+bool StemResolver::isValid(const AffixGroup& group, const Candidate& c, bool without_stems) {
+	const std::map<Char, int>& min = group.getMinScores();
+	if (!without_stems) {
+		for (auto& s : c.scores) {
+			if (min.at(s.first) > s.second) {
+				return false;
+			}
+		}
+		return true;
+	}
+	for (auto& s : c.stem_scores) {
+		if (min.at(s.first) > c.scores.at(s.first) - s.second) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void StemResolver::resolveGroup(AffixGroup& group, size_t rank) {
+	std::vector<Candidate> candidates;
+	std::unordered_map<Word*, size_t> candidate_of;
+	// The candidates a word is derived from, and by which affix.
+	std::unordered_map<Word*, std::vector<std::pair<size_t, const Affix*> > > derived_from;
+
+	for (auto& e : edges[rank]) {
+		if (!e.derived->matchable()) {
+			continue; // Claimed by an earlier group (rule 1).
+		}
+		if (!inVariant(e)) {
+			continue;
+		}
+
+		auto i = candidate_of.find(e.stem);
+		if (i == candidate_of.end()) {
+			bool known = variant == 0 ? words.contains(e.stem->getWord()) : e.stem->inVariant(variant);
+			i = candidate_of.emplace(e.stem, candidates.size()).first;
+			candidates.push_back({e.stem, 0, known, {}, {}});
+			for (auto& m : group.getMinScores()) {
+				candidates.back().scores.emplace(m.first, 0);
+			}
+		}
+
+		Candidate& c = candidates[i->second];
+		c.scores.at(e.affix->getScoreId()) += e.affix->getScore();
+		c.total += e.affix->getScore();
+		e.stem->addAffix(group, *e.affix, *e.derived);
+		derived_from[e.derived].emplace_back(i->second, e.affix);
+	}
+	if (variant == 0) {
+		edges[rank] = decltype(edges)::value_type();
+	}
+
+	// Confirming a stem lowers the scores of the stems it is derived from.
+	auto confirm = [&] (Candidate& c) {
+		group.confirmStem(*c.stem);
+		auto d = derived_from.find(c.stem);
+		if (d == derived_from.end()) {
+			return;
+		}
+		for (auto& f : d->second) {
+			auto& stem_scores = candidates[f.first].stem_scores;
+			auto s = stem_scores.emplace(f.second->getScoreId(), f.second->getScore()).first;
+			s->second = std::max(s->second, f.second->getScore());
+		}
+	};
+
+	std::vector<size_t> queue;
+	for (size_t i = 0; i < candidates.size(); i++) {
+		Candidate& c = candidates[i];
+		if (!group.isMatchingStemType(c.stem->getStemType())) {
+			continue;
+		}
+		if (c.stem->isStemOf(group)) {
+			confirm(c); // Rule 2
+			continue;
+		}
+		if (isValid(group, c, false)) {
+			queue.push_back(i);
+		}
+	}
+
+	// The priorities never change, so the queue is simply sorted.
+	std::sort(queue.begin(), queue.end(), [&] (size_t a, size_t b) {
+			return precedes(candidates[a], candidates[b]);
+		});
+
+	for (auto i : queue) {
+		Candidate& c = candidates[i];
+		if (c.stem->hasStem()) {
+			continue;
+		}
+		if (isValid(group, c, true)) {
+			confirm(c);
+		}
+	}
+}
@@ -0,0 +1,107 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_STEM_RESOLVER_H_
+#define _XMUNCH_STEM_RESOLVER_H_
+
+#include "xmunch.h"
+#include "word-set.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace xmunch {
+
+	/**
+	 * Resolves the matches of all affix groups at once, after all groups
+	 * were matched. Matches are edges from a candidate stem to a derived
+	 * word. Claims are decided by this precedence:
+	 *
+	 * 1. group rank: groups in affix file order, a word derived from a stem
+	 *    or being a stem after a group isn't matched by later groups,
+	 * 2. stems confirmed by premunched data,
+	 * 3. total score (higher first),
+	 * 4. stem length (shorter first),
+	 * 5. words of the word list before virtual stems,
+	 * 6. word list position, virtual stems by the stem itself.
+	 *
+	 * A stem is dropped if it was derived from an earlier one, or if, for a
+	 * derived word which became a stem, its score without that word is too
+	 * low. These scores are updated when a stem is confirmed instead of
+	 * rescanning the affix lists. The result is the same as resolving each
+	 * group after matching it.
+	 *
+	 * With --variants, the matches of all word lists are collected at once
+	 * and resolved for each variant, using only the matches between its
+	 * words. A word missing in the variant takes the place of a virtual
+	 * stem candidate there.
+	 */
+	class StemResolver {
+		struct Edge {
+			Word* stem;
+			Word* derived;
+			const Affix* affix;
+		};
+
+		struct Candidate {
+			Word* stem;
+			int total;
+			bool known; // In the word list
+			std::map<Char, int> scores;
+			// Per score name, the highest score of a derived word which is
+			// a stem itself.
+			std::map<Char, int> stem_scores;
+		};
+
+		AffixGroupList& groups;
+		std::unordered_map<const AffixGroup*, size_t> ranks;
+		std::vector<std::vector<Edge, TaggedAllocator<Edge, MemoryTag::SCORES> > > edges;
+
+		const WordSet& words;
+
+		// The variant being resolved, 0 for all words.
+		VariantSet variant;
+
+		public:
+			StemResolver(AffixGroupList& g, const WordSet& w);
+
+			void addEdge(const AffixGroup& group, Word& stem, const Affix& affix, Word& derived);
+
+			// Confirm the stems of all groups.
+			void resolve();
+
+			// Confirm the stems of all groups for the words of variant v.
+			// The matches are kept to resolve the next one.
+			void resolve(VariantSet v);
+
+		protected:
+			void resolveGroup(AffixGroup& group, size_t rank);
+
+			// Whether the match e exists in the current variant.
+			bool inVariant(const Edge& e) const;
+
+			// True if a is confirmed before b (rules 3 to 6).
+			static bool precedes(const Candidate& a, const Candidate& b);
+
+			// Check the scores against the minimum scores of group, without
+			// the score of a derived stem if without_stems is set.
+			static bool isValid(const AffixGroup& group, const Candidate& c, bool without_stems);
+	};
+}
+
+#endif /* ifndef _XMUNCH_STEM_RESOLVER_H_ */
@@ -0,0 +1,123 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "trace.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace xmunch;
+
+namespace {
+	struct Event {
+		const char* name;
+		std::string arg;
+		Trace::Clock::time_point begin;
+		Trace::Clock::time_point end;
+	};
+
+	struct ThreadBuffer {
+		size_t tid;
+		std::string name;
+		std::vector<Event> events;
+	};
+
+	std::mutex buffers_lock;
+	std::vector<std::unique_ptr<ThreadBuffer> > buffers;
+	Trace::Clock::time_point start;
+
+	// Registered on the first span of a thread, the buffers outlive the
+	// threads until the trace is written.
+	ThreadBuffer& thread_buffer() {
+		thread_local ThreadBuffer* b = nullptr;
+		if (b == nullptr) {
+			std::lock_guard<std::mutex> l(buffers_lock);
+			buffers.emplace_back(new ThreadBuffer());
+			b = buffers.back().get();
+			b->tid = buffers.size();
+			b->name = b->tid == 1 ? "main" : "worker " + std::to_string(b->tid - 1);
+		}
+		return *b;
+	}
+
+	void write_string(std::ostream& out, const std::string& s) {
+		out << '"';
+		for (unsigned char c : s) {
+			if (c == '"' || c == '\\') {
+				out << '\\' << c;
+			} else if (c < 0x20) {
+				out << ' ';
+			} else {
+				out << c;
+			}
+		}
+		out << '"';
+	}
+
+	double micros(Trace::Clock::time_point t) {
+		return std::chrono::duration<double, std::micro>(t - start).count();
+	}
+}
+
+bool Trace::enabled = false;
+
+void Trace::enable() {
+	start = Clock::now();
+	enabled = true;
+	// The thread enabling it is the main one.
+	thread_buffer();
+}
+
+void Trace::setThreadName(const std::string& name) {
+	if (enabled) {
+		thread_buffer().name = name;
+	}
+}
+
+void Trace::record(const char* name, const std::string& arg, Clock::time_point begin, Clock::time_point end) {
+	thread_buffer().events.push_back({name, arg, begin, end});
+}
+
+void Trace::write(std::ostream& out) {
+	std::lock_guard<std::mutex> l(buffers_lock);
+	out << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (auto& b : buffers) {
+		out << (first ? "" : ",\n")
+			<< "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << b->tid
+			<< ",\"args\":{\"name\":";
+		write_string(out, b->name);
+		out << "}}";
+		first = false;
+
+		for (auto& e : b->events) {
+			out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid << ",\"name\":";
+			write_string(out, e.arg.empty() ? std::string(e.name) : std::string(e.name) + " " + e.arg);
+			out << ",\"ts\":" << std::fixed << micros(e.begin)
+				<< ",\"dur\":" << micros(e.end) - micros(e.begin);
+			if (!e.arg.empty()) {
+				out << ",\"args\":{\"detail\":";
+				write_string(out, e.arg);
+				out << "}";
+			}
+			out << "}";
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
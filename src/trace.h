@@ -0,0 +1,88 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_TRACE_H_
+#define _XMUNCH_TRACE_H_
+
+#include <chrono>
+#include <ostream>
+#include <string>
+
+namespace xmunch {
+
+	/**
+	 * Timeline of the phases of a run (--trace), written as Chrome trace
+	 * event JSON, which chrome://tracing, Perfetto and speedscope can show.
+	 * Every thread records its spans in its own buffer. If tracing isn't
+	 * enabled, a span costs one check of a flag.
+	 */
+	class Trace {
+		static bool enabled;
+
+		public:
+			typedef std::chrono::steady_clock Clock;
+
+			static void enable();
+			static bool isEnabled() { return enabled; }
+
+			// Name the calling thread in the timeline.
+			static void setThreadName(const std::string& name);
+
+			static void record(const char* name, const std::string& arg, Clock::time_point begin, Clock::time_point end);
+
+			// Write the spans of all threads, which must have finished.
+			static void write(std::ostream& out);
+
+			/**
+			 * Records the time from its construction to its destruction.
+			 * arg is shown with the span, like the name of an affix group.
+			 * It is only read at the end, so it must outlive the span.
+			 */
+			class Span {
+				const char* name;
+				const std::string* arg;
+				Clock::time_point begin;
+
+				public:
+					Span(const char* n, const std::string& a) : name(n), arg(&a) {
+						if (enabled) {
+							begin = Clock::now();
+						}
+					}
+
+					Span(const char* n, std::string&& a) = delete;
+
+					Span(const char* n) : name(n), arg(nullptr) {
+						if (enabled) {
+							begin = Clock::now();
+						}
+					}
+
+					~Span() {
+						if (enabled) {
+							record(name, arg == nullptr ? std::string() : *arg, begin, Clock::now());
+						}
+					}
+
+					Span(const Span&) = delete;
+					Span& operator=(const Span&) = delete;
+			};
+	};
+}
+
+#endif /* ifndef _XMUNCH_TRACE_H_ */
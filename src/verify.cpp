@@ -0,0 +1,142 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "verify.h"
+
+#include "word.h"
+#include "affix.h"
+#include "alphabet.h"
+
+using namespace xmunch;
+
+size_t WordBitset::count() const {
+	size_t c = 0;
+	for (auto b : bits) {
+		c += __builtin_popcountll(b);
+	}
+	return c;
+}
+
+static void print_json_string(std::ostream& out, const String& s) {
+	out << '"';
+	for (unsigned char c : s) {
+		if (c == '"' || c == '\\') {
+			out << '\\' << c;
+		} else if (c < 0x20) {
+			static const char hex[] = "0123456789abcdef";
+			out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+		} else {
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+Verifier::Verifier(
+					WordList& w,
+					const WordSet& wi,
+					WordList& virtual_w,
+					AffixGroupList& a
+				):
+words(w), index(wi), vwords(virtual_w), affixes(a), word_count(0) {}
+
+void Verifier::run() {
+	word_count = 0;
+	for (auto& w : words) {
+		w.setId(word_count++);
+	}
+	reached.resize(word_count);
+	introduced.clear();
+	group_counts.clear();
+
+	for (auto& w : words) {
+		if (w.hasStem()) {
+			continue;
+		}
+		// Printed as it is.
+		reached.set(w.getId());
+		if (w.isStem()) {
+			expand(w);
+		}
+	}
+	for (auto& w : vwords) {
+		if (w.isStem()) {
+			expand(w);
+		}
+	}
+}
+
+void Verifier::expand(Word& stem) {
+	StringList forms;
+	for (auto g : stem.getStemOf()) {
+		GroupCount& gc = group_counts[g];
+		gc.stems++;
+
+		forms.clear();
+		g->generate(stem.getWord(), forms);
+		for (auto& f : forms) {
+			gc.forms++;
+			Word* i = index.find(f);
+			if (i != nullptr) {
+				gc.known++;
+				reached.set(i->getId());
+			} else {
+				gc.introduced++;
+				introduced.insert(f);
+			}
+		}
+	}
+}
+
+void Verifier::print(std::ostream& out) {
+	size_t r = reached.count();
+
+	out << "{\"words\":" << word_count
+		<< ",\"reached\":" << r
+		<< ",\"lost\":" << word_count - r
+		<< ",\"introduced\":" << introduced.size()
+		<< ",\"groups\":[";
+
+	bool first = true;
+	for (auto& g : affixes) {
+		auto i = group_counts.find(&g);
+		GroupCount gc;
+		if (i != group_counts.end()) {
+			gc = i->second;
+		}
+		out << (first ? "" : ",") << "{\"name\":";
+		print_json_string(out, g.getName());
+		out << ",\"stems\":" << gc.stems
+			<< ",\"forms\":" << gc.forms
+			<< ",\"known\":" << gc.known
+			<< ",\"introduced\":" << gc.introduced << "}";
+		first = false;
+	}
+
+	out << "],\"lost_words\":[";
+	first = true;
+	for (auto& w : words) {
+		if (reached.test(w.getId())) {
+			continue;
+		}
+		out << (first ? "" : ",");
+		print_json_string(out, Alphabet::decode(w.getWord()));
+		first = false;
+	}
+	out << "]}" << std::endl;
+}
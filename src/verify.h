@@ -0,0 +1,88 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_VERIFY_H_
+#define _XMUNCH_VERIFY_H_
+
+#include "xmunch.h"
+#include "word-set.h"
+
+#include <cstdint>
+#include <vector>
+#include <unordered_set>
+#include <ostream>
+
+namespace xmunch {
+
+	class WordBitset {
+		std::vector<uint64_t> bits;
+
+		public:
+			void resize(size_t n) { bits.assign((n + 63) / 64, 0); }
+
+			void set(size_t i) { bits[i >> 6] |= uint64_t(1) << (i & 63); }
+			bool test(size_t i) const { return (bits[i >> 6] >> (i & 63)) & 1; }
+
+			size_t count() const;
+	};
+
+	/**
+	 * Checks the munched result by expanding every stem of the output again
+	 * and marking the words reached. Input words which are never reached
+	 * are lost, generated forms which are not in the input are new.
+	 */
+	class Verifier {
+		struct GroupCount {
+			size_t stems = 0;
+			size_t forms = 0;
+			size_t known = 0;
+			size_t introduced = 0;
+		};
+
+		WordList& words;
+		const WordSet& index;
+		WordList& vwords;
+		AffixGroupList& affixes;
+
+		size_t word_count;
+		WordBitset reached;
+
+		std::unordered_set<String> introduced;
+		std::map<const AffixGroup*, GroupCount> group_counts;
+
+		public:
+
+			Verifier(
+					WordList& w,
+					const WordSet& wi,
+					WordList& virtual_w,
+					AffixGroupList& a
+				);
+
+			void run();
+
+			// Print a JSON summary of the last run.
+			void print(std::ostream& out);
+
+		protected:
+
+			void expand(Word& stem);
+	};
+}
+
+#endif /* ifndef _XMUNCH_VERIFY_H_ */
@@ -0,0 +1,54 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_WORD_HASH_H_
+#define _XMUNCH_WORD_HASH_H_
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+namespace xmunch {
+
+	/**
+	 * Hash for words. Words of up to 16 bytes (most of them, with
+	 * --remap-alphabet) are packed into two 64 bit integers and mixed,
+	 * longer ones use std::hash.
+	 */
+	struct WordHash {
+		size_t operator()(const std::string& s) const {
+			size_t n = s.length();
+			if (n > 16) {
+				return std::hash<std::string>()(s);
+			}
+
+			uint64_t k[2] = {0, 0};
+			std::memcpy(k, s.data(), n);
+
+			uint64_t h = (k[0] * 0x9E3779B97F4A7C15ULL) ^
+				((k[1] + n) * 0xC2B2AE3D27D4EB4FULL);
+			h ^= h >> 29;
+			h *= 0xBF58476D1CE4E5B9ULL;
+			h ^= h >> 32;
+			return static_cast<size_t>(h);
+		}
+	};
+}
+
+#endif /* ifndef _XMUNCH_WORD_HASH_H_ */
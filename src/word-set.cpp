@@ -0,0 +1,96 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "word-set.h"
+#include "word.h"
+
+#include <algorithm>
+
+using namespace xmunch;
+
+void WordSet::buildTable() {
+	size_t slots = 16;
+	while (slots * 7 < index.size() * 10) {
+		slots *= 2;
+	}
+	mask = slots - 1;
+	table.assign(slots, Slot{0, nullptr});
+
+	// The keys of the index are at hand while walking it, the words and
+	// the slots are all over memory: hash a block of words first and load
+	// their slots before filling them.
+	const size_t block = 32;
+	size_t hashes[block];
+	WordHash hash;
+	auto w = index.begin();
+	while (w != index.end()) {
+		size_t n = 0;
+		for (; n < block && w != index.end(); ++w, n++) {
+			hashes[n] = hash(w->first);
+			prefetch(hashes[n]);
+			words.push_back(&w->second);
+		}
+		for (size_t j = 0; j < n; j++) {
+			size_t i = hashes[j] & mask;
+			while (table[i].word != nullptr) {
+				i = (i + 1) & mask;
+			}
+			table[i] = Slot{hashes[j], words[words.size() - n + j]};
+		}
+	}
+}
+
+Word* WordSet::find(const String& w, size_t hash) const {
+	if (type == WordSetType::DAWG) {
+		size_t id = dawg.find(w);
+		return id == Dawg::NOT_FOUND ? nullptr : words[id];
+	}
+	for (size_t i = hash & mask; table[i].word != nullptr; i = (i + 1) & mask) {
+		if (table[i].hash == hash && table[i].word->getWord() == w) {
+			return table[i].word;
+		}
+	}
+	return nullptr;
+}
+
+void WordSet::build(WordSetType t) {
+	type = t;
+	words.clear();
+	words.reserve(index.size());
+	if (type == WordSetType::HASH) {
+		buildTable();
+		return;
+	}
+
+	for (auto& w : index) {
+		words.push_back(&w.second);
+	}
+
+	// The DAWG ids are the positions in byte order (std::string compares
+	// as unsigned char).
+	std::sort(words.begin(), words.end(), [] (const Word* a, const Word* b) {
+			return a->getWord() < b->getWord();
+		});
+
+	std::vector<const String*> sorted;
+	sorted.reserve(words.size());
+	for (auto w : words) {
+		sorted.push_back(&w->getWord());
+	}
+	dawg.build(sorted);
+}
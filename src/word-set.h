@@ -0,0 +1,107 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_WORD_SET_H_
+#define _XMUNCH_WORD_SET_H_
+
+#include "xmunch.h"
+#include "dawg.h"
+
+#include <vector>
+
+namespace xmunch {
+
+	enum class WordSetType : char {
+		HASH, // Look words up in a hash table
+		DAWG // Look words up in a minimal automaton
+	};
+
+	/**
+	 * The words of the word list while matching and afterwards: lookups of
+	 * candidate stems and derived forms, and iteration over all words.
+	 *
+	 * The hash table keeps the WordHash of every word next to it, with
+	 * linear probing in a flat array. A lookup with a known hash usually
+	 * touches one slot and the word found there, so batches of lookups can
+	 * load these ahead (see MatchContext::flushProbes).
+	 */
+	class WordSet {
+		public:
+			typedef std::vector<Word*, TaggedAllocator<Word*, MemoryTag::INDEX> > List;
+
+		private:
+			struct Slot {
+				size_t hash;
+				Word* word; // nullptr if empty
+			};
+
+			Index& index;
+			WordSetType type;
+			Dawg dawg;
+
+			// With HASH, a power of two slots, at most 70% used.
+			std::vector<Slot, TaggedAllocator<Slot, MemoryTag::INDEX> > table;
+			size_t mask;
+
+			// With a DAWG in the order of its ids.
+			List words;
+
+			// Fills words and table from the index.
+			void buildTable();
+
+		public:
+			WordSet(Index& i) : index(i), type(WordSetType::HASH), mask(0) {}
+
+			// Reads the words from the index, which can be dropped
+			// afterwards.
+			void build(WordSetType t);
+
+			Word* find(const String& w) const {
+				return find(w, type == WordSetType::HASH ? WordHash()(w) : 0);
+			}
+
+			// Like find, with the WordHash of w (ignored with DAWG).
+			Word* find(const String& w, size_t hash) const;
+
+			bool contains(const String& w) const { return find(w) != nullptr; }
+
+			// The first word with hash, usually the one looked for if there
+			// is one. Only with HASH.
+			Word* candidate(size_t hash) const {
+				for (size_t i = hash & mask; table[i].word != nullptr; i = (i + 1) & mask) {
+					if (table[i].hash == hash) {
+						return table[i].word;
+					}
+				}
+				return nullptr;
+			}
+
+			// Load the slot of hash into the cache. Only with HASH.
+			void prefetch(size_t hash) const {
+				__builtin_prefetch(&table[hash & mask]);
+			}
+
+			size_t size() const { return words.size(); }
+			const List& all() const { return words; }
+
+			WordSetType getType() const { return type; }
+			const Dawg& getDawg() const { return dawg; }
+	};
+}
+
+#endif /* ifndef _XMUNCH_WORD_SET_H_ */
@@ -21,9 +21,12 @@
 
 #include "xmunch.h"
 #include "affix.h"
+#include "match-kernel.h"
+#include "alphabet.h"
 #include <map>
 #include <set>
 #include <fstream>
+#include <utility>
 
 namespace xmunch {
 
@@ -34,31 +37,77 @@ namespace xmunch {
 		AffixedWord(Word& w, const Affix& f) : word(w), affix(f) {}
 	};
 
+	typedef std::set<AffixGroup*, AffixGroupOrder, TaggedAllocator<AffixGroup*, MemoryTag::AFFIXES> > AffixGroupSet;
+
 	class Word {
 
 		String word;
+		WordKey key;
+
+		size_t id;
+
+		VariantSet variants;
 
 		bool has_stem;
 
-		std::map<AffixGroup*, AffixedWordList> affixes;
+		std::map<
+				AffixGroup*,
+				AffixedWordList,
+				std::less<AffixGroup*>,
+				TaggedAllocator<std::pair<AffixGroup* const, AffixedWordList>, MemoryTag::AFFIXES>
+			> affixes;
 
-		std::set<AffixGroup*> stem_of;
+		AffixGroupSet stem_of;
 
 		StemType is_type;
 
 		public:
-			Word(String w) : word(w), has_stem(false), is_type(StemType::NORMAL) {};
+			Word(String w) : word(std::move(w)), id(0), variants(0), has_stem(false), is_type(StemType::NORMAL) {
+				key.set(word);
+			};
 
 			~Word() {};
 
 			const String& getWord() const { return word; }
+			const WordKey& getKey() const { return key; }
+
+			// Position in the word list, the Verifier assigns dense ids to all words.
+			size_t getId() const { return id; }
+			void setId(size_t i) { id = i; }
+
+			// The word lists the word was read from.
+			VariantSet getVariants() const { return variants; }
+			bool inVariant(VariantSet v) const { return (variants & v) != 0; }
+			void addVariants(VariantSet v) { variants |= v; }
 
 			bool isStem() const { return !stem_of.empty(); }
 			bool isStemOf(AffixGroup& group) const { return stem_of.count(&group) == 1; }
+			const AffixGroupSet& getStemOf() const { return stem_of; }
 			bool hasStem() const { return has_stem; }
 			bool matchable() const { return stem_of.empty() && !has_stem; }
 
-			void addAffix(AffixGroup& g, const Affix& f, Word& w) { affixes[&g].emplace_back(w, f); }
+			void addAffix(AffixGroup& g, const Affix& f, Word& w) {
+				auto i = affixes.find(&g);
+				if (i == affixes.end()) {
+					i = affixes.emplace(&g, AffixedWordList(g.getListAllocator())).first;
+				}
+				i->second.emplace_back(w, f);
+			}
+
+			// Copy the affix list of group out of the scratch arena if keep
+			// is set, drop it otherwise. Lists on the heap aren't touched.
+			void settleAffixes(AffixGroup& g, bool keep) {
+				auto i = affixes.find(&g);
+				if (i == affixes.end() || i->second.get_allocator().getArena() == nullptr) {
+					return;
+				}
+				if (keep) {
+					AffixedWordList l(i->second.begin(), i->second.end());
+					i->second.swap(l);
+				} else {
+					affixes.erase(i);
+				}
+			}
 
 			bool hasAffixOfGroup(AffixGroup& group) const { return affixes.count(&group) == 1 && affixes.at(&group).size() != 0; }
 			AffixedWordList& getAffixesByGroup(AffixGroup& group) { return affixes[&group]; }
@@ -67,12 +116,20 @@ namespace xmunch {
 			void setHasStem(bool hs) { has_stem = hs; }
 
 			void setStemType(StemType t) { is_type = t; }
+
+			// Forget all matches, to resolve the stems of another variant.
+			void resetStem(StemType t) {
+				affixes.clear();
+				stem_of.clear();
+				has_stem = false;
+				is_type = t;
+			}
 			StemType getStemType() const { return is_type; }
 
 			void format(std::ostream& out) {
-				out << word;
+				out << Alphabet::decode(word);
 				if (stem_of.empty()) {
-					out << std::endl;
+					out << '\n';
 					return;
 				}
 				out << AffixGroup::getStemSep();
@@ -84,13 +141,13 @@ namespace xmunch {
 				if (is_type == StemType::VIRTUAL || is_type == StemType::OPTIONAL) {
 					out << (first ? String("") : AffixGroup::getAffSep()) << AffixGroup::getVirtMark();
 				}
-				out << std::endl;
+				out << '\n';
 			}
 
 			void format_uncompressed(std::ostream& out) {
-				out << word;
+				out << Alphabet::decode(word);
 				if (stem_of.empty()) {
-					out << ";" << std::endl;
+					out << ";\n";
 					return;
 				}
 
@@ -101,21 +158,21 @@ namespace xmunch {
 				} else if (is_type == StemType::CREATE) {
 					out << "@C";
 				}
-				out << " {" << std::endl;
+				out << " {\n";
 
 				for (auto ag : stem_of) {
-					out << "\t" << ag->getName() << " {" << std::endl;
+					out << "\t" << ag->getName() << " {\n";
 					for (auto a : getAffixesByGroup(*ag)) {
 						if (a.word.isStem()) {
 							continue;
 						}
 
-						out << "\t\t" << a.word.word << std::endl;
+						out << "\t\t" << Alphabet::decode(a.word.word) << '\n';
 					}
-					out << "\t}" << std::endl;
+					out << "\t}\n";
 				}
 
-				out << "};" << std::endl;
+				out << "};\n";
 			}
 	};
 }
@@ -0,0 +1,196 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "wordlist-loader.h"
+
+#include "word.h"
+#include "word-hash.h"
+#include "alphabet.h"
+#include "trace.h"
+
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace xmunch;
+
+namespace {
+	enum class LineKind : char {
+		WORD,
+		DUPLICATE,
+		EMPTY,
+		COMMENT
+	};
+
+	bool is_blank(Char c) {
+		return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	// Returns true if l was changed.
+	bool trim(String& l) {
+		size_t e = l.length();
+		while (e > 0 && is_blank(l[e - 1])) {
+			e--;
+		}
+		size_t b = 0;
+		while (b < e && is_blank(l[b])) {
+			b++;
+		}
+		if (b == 0 && e == l.length()) {
+			return false;
+		}
+		l = l.substr(b, e - b);
+		return true;
+	}
+
+	template<class F>
+	void run_workers(size_t threads, F f) {
+		if (threads < 2) {
+			f(0);
+			return;
+		}
+		std::vector<std::thread> workers;
+		for (size_t t = 0; t < threads; t++) {
+			workers.emplace_back(f, t);
+		}
+		for (auto& w : workers) {
+			w.join();
+		}
+	}
+}
+
+void WordListLoader::load(size_t threads) {
+	String l;
+	std::getline(src, l);
+
+	std::vector<String> lines;
+	{
+		Trace::Span span("read lines");
+		try {
+			int count = std::stoi(l);
+			if (count > 0) {
+				lines.reserve(count);
+			}
+		} catch (std::invalid_argument &e) {
+			std::cerr << "WARNING, dictionary file should contain the number of words in the first line." << std::endl;
+			lines.push_back(l);
+		}
+		while (std::getline(src, l)) {
+			lines.push_back(std::move(l));
+		}
+	}
+
+	size_t n = lines.size();
+	if (n < 4096) {
+		threads = 1;
+	}
+
+	// Trim and classify the lines in chunks.
+	std::vector<LineKind> kind(n);
+	std::vector<size_t> hashes(threads > 1 ? n : 0);
+	std::vector<Counts> partial(threads);
+	run_workers(threads, [&] (size_t t) {
+			Trace::Span span("trim lines");
+			Counts& c = partial[t];
+			WordHash hash;
+			for (size_t i = n * t / threads; i < n * (t + 1) / threads; i++) {
+				if (trim(lines[i])) {
+					c.trimmed++;
+				}
+				if (drop_empty && lines[i].empty()) {
+					kind[i] = LineKind::EMPTY;
+				} else if (drop_comments && !lines[i].empty() && lines[i][0] == '#') {
+					kind[i] = LineKind::COMMENT;
+				} else {
+					kind[i] = LineKind::WORD;
+					if (threads > 1) {
+						hashes[i] = hash(lines[i]);
+					}
+				}
+			}
+		});
+
+	// Every thread looks for duplicates among the words with its share of
+	// hash values. Going through them in input order keeps the first copy.
+	// A single thread finds them while filling the index instead.
+	if (threads > 1) {
+		run_workers(threads, [&] (size_t t) {
+				Trace::Span span("find duplicates");
+				auto h = [&hashes] (size_t i) { return hashes[i]; };
+				auto eq = [&lines] (size_t a, size_t b) { return lines[a] == lines[b]; };
+				std::unordered_set<size_t, decltype(h), decltype(eq)> seen(n / threads + 1, h, eq);
+				for (size_t i = 0; i < n; i++) {
+					if (kind[i] == LineKind::WORD && hashes[i] % threads == t && !seen.insert(i).second) {
+						kind[i] = LineKind::DUPLICATE;
+						partial[t].duplicates++;
+					}
+				}
+			});
+	}
+
+	counts = Counts();
+	counts.lines = n;
+	for (auto& c : partial) {
+		counts.trimmed += c.trimmed;
+		counts.duplicates += c.duplicates;
+	}
+	for (auto k : kind) {
+		if (k == LineKind::EMPTY) {
+			counts.empty++;
+		} else if (k == LineKind::COMMENT) {
+			counts.comments++;
+		}
+	}
+
+	size_t id = index.size();
+	size_t added = n - counts.duplicates - counts.empty - counts.comments;
+	index.reserve(id + added);
+	if (order) {
+		order->reserve(added);
+	}
+
+	// The ids keep the input order, used to decide between equally good stems.
+	Trace::Span span("fill index");
+	for (size_t i = 0; i < n; i++) {
+		if (kind[i] != LineKind::WORD) {
+			continue;
+		}
+		words.emplace_front(Alphabet::isEnabled() ? Alphabet::encode(lines[i]) : std::move(lines[i]));
+		auto r = index.emplace(words.begin()->getWord(), *(words.begin()));
+		if (!r.second) {
+			words.pop_front();
+			Word& w = r.first->second;
+			if (w.inVariant(variant)) {
+				counts.duplicates++;
+			} else {
+				w.addVariants(variant);
+				counts.shared++;
+				if (order) {
+					order->push_back(&w);
+				}
+			}
+			continue;
+		}
+		words.begin()->setId(id++);
+		words.begin()->addVariants(variant);
+		if (order) {
+			order->push_back(&*words.begin());
+		}
+	}
+}
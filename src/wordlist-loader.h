@@ -0,0 +1,86 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef _XMUNCH_WORDLIST_LOADER_H_
+#define _XMUNCH_WORDLIST_LOADER_H_
+
+#include "xmunch.h"
+#include "parallel-sort.h"
+
+#include <istream>
+#include <vector>
+
+namespace xmunch {
+
+	/**
+	 * Reads the word list. Lines are trimmed (spaces, tabs and CR at both
+	 * ends) and only the first copy of a word is kept, duplicates would
+	 * otherwise be written again without being matched. Trimming and
+	 * duplicate detection run on several threads, the words are then added
+	 * in input order.
+	 *
+	 * Several word lists can be read into the same word list, a word read
+	 * before from another list only gets the variant of this one.
+	 */
+	class WordListLoader {
+		public:
+			struct Counts {
+				size_t lines = 0; // Without the word count line
+				size_t trimmed = 0;
+				size_t duplicates = 0;
+				size_t empty = 0; // Dropped ones
+				size_t comments = 0;
+				size_t shared = 0; // Read before from another list
+			};
+
+		private:
+			std::istream& src;
+
+			WordList& words;
+			Index& index;
+
+			bool drop_empty;
+			bool drop_comments;
+
+			VariantSet variant;
+			std::vector<Word*>* order;
+
+			Counts counts;
+
+		public:
+			WordListLoader(std::istream& input, WordList& w, Index& wi)
+				: src(input), words(w), index(wi), drop_empty(false), drop_comments(false), variant(1), order(nullptr) {}
+
+			// Skip empty lines (after trimming) and lines starting with '#'.
+			void dropEmpty(bool d) { drop_empty = d; }
+			void dropComments(bool d) { drop_comments = d; }
+
+			// The words are marked as part of the i-th variant.
+			void setVariant(size_t i) { variant = VariantSet(1) << i; }
+
+			// Add all words of this list to o, in input order, also the
+			// ones read before from another list.
+			void keepOrder(std::vector<Word*>& o) { order = &o; }
+
+			void load(size_t threads = worker_count());
+
+			const Counts& getCounts() const { return counts; }
+	};
+}
+
+#endif /* ifndef _XMUNCH_WORDLIST_LOADER_H_ */
@@ -19,11 +19,15 @@
 #ifndef _XMUNCH_XMUNCH_H_
 #define _XMUNCH_XMUNCH_H_ 
 
+#include <cstdint>
 #include <string>
 #include <list>
 #include <map>
 #include <unordered_map>
 
+#include "word-hash.h"
+#include "memory-report.h"
+
 namespace xmunch {
 	class Word;
 	class Affix;
@@ -33,14 +37,23 @@ namespace xmunch {
 	typedef char Char;
 	typedef std::string String;
 
-	typedef std::unordered_map<String, Word&> Index;
-	typedef std::list<Word> WordList;
+	typedef std::unordered_map<
+			String,
+			Word&,
+			WordHash,
+			std::equal_to<String>,
+			TaggedAllocator<std::pair<const String, Word&>, MemoryTag::INDEX>
+		> Index;
+	typedef std::list<Word, TaggedAllocator<Word, MemoryTag::WORDS> > WordList;
 
 	typedef std::list<String> StringList;
 
+	// A bit per word list of a --variants run.
+	typedef std::uint64_t VariantSet;
+
 	typedef std::list<AffixGroup> AffixGroupList;
 
-	typedef std::list<AffixedWord> AffixedWordList;
+	typedef std::list<AffixedWord, TaggedAllocator<AffixedWord, MemoryTag::AFFIXES> > AffixedWordList;
 }
 
 #endif /* ifndef _XMUNCH_XMUNCH_H_ */
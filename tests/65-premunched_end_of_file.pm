@@ -0,0 +1,3 @@
+ბარ;
+bar;
+xyz
\ No newline at end of file
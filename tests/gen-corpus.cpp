@@ -0,0 +1,187 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/**
+ * Writes a random word list and affix file, to compare the matching engines
+ * of xmunch (see check-engines). Usage: gen-corpus seed output-prefix
+ **/
+
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+typedef std::string String;
+
+struct Definition {
+	String replace;
+	String affix;
+	String score;
+};
+
+struct Group {
+	String name;
+	String header;
+	std::vector<Definition> defs;
+};
+
+class Generator {
+	std::mt19937 rng;
+
+	public:
+		Generator(unsigned seed) : rng(seed) {}
+
+		int number(int a, int b) {
+			return std::uniform_int_distribution<int>(a, b)(rng);
+		}
+
+		bool chance(double p) {
+			return std::uniform_real_distribution<double>(0, 1)(rng) < p;
+		}
+
+		String text(int a, int b) {
+			static const char letters[] = "abcdefgh";
+			String s;
+			for (int i = number(a, b); i > 0; i--) {
+				s += letters[number(0, 7)];
+			}
+			return s;
+		}
+
+		String replacement() {
+			switch (number(0, 3)) {
+				case 0: return "x";
+				case 1: return "a,b";
+				default: return ".";
+			}
+		}
+
+		Definition definition(bool named_scores) {
+			Definition d;
+			switch (number(0, 5)) {
+				case 0: // suffix with stem ending condition
+					d.replace = "a,b";
+					d.affix = "." + text(1, 2);
+					break;
+				case 1: // prefix
+					d.replace = replacement();
+					d.affix = text(1, 2) + "-";
+					break;
+				case 2: // circumfix
+					d.replace = ". : .";
+					d.affix = text(1, 2) + "-" + text(1, 2);
+					break;
+				case 3: // circumfix with conditions on both sides
+					d.replace = "a,b : c,d";
+					d.affix = text(1, 2) + ".-." + text(1, 2);
+					break;
+				default: // suffix
+					d.replace = replacement();
+					d.affix = text(1, 2);
+			}
+			if (chance(0.3)) {
+				d.score = "(" + std::to_string(number(-1, 2)) + (named_scores ? "a" : "") + ")";
+			} else if (named_scores) {
+				d.score = chance(0.5) ? "(1a)" : "(1)";
+			}
+			return d;
+		}
+
+		Group group(int n) {
+			Group g;
+			g.name = "G" + std::to_string(n);
+			bool named = chance(0.2);
+			g.header = std::to_string(number(1, 3));
+			if (named) {
+				g.header += " 1a";
+			}
+			static const char* flags[] = {"", "", "", " v", " o", " c"};
+			g.header += flags[number(0, 5)];
+			for (int i = number(1, 6); i > 0; i--) {
+				g.defs.push_back(definition(named));
+			}
+			return g;
+		}
+
+		// Apply a definition to a stem, like a dictionary would.
+		String derive(const String& stem, const Definition& d) {
+			String a = d.affix;
+			a.erase(std::remove(a.begin(), a.end(), '.'), a.end());
+			size_t dash = a.find('-');
+			if (dash == String::npos) {
+				return stem + a;
+			}
+			return a.substr(0, dash) + stem + a.substr(dash + 1);
+		}
+
+		void write(const String& prefix) {
+			std::vector<String> stems;
+			for (int i = number(20, 120); i > 0; i--) {
+				stems.push_back(text(2, 5));
+			}
+			std::vector<Group> groups;
+			for (int i = number(1, 5); i > 0; i--) {
+				groups.push_back(group(groups.size()));
+			}
+
+			std::set<String> unique;
+			for (auto& s : stems) {
+				if (chance(0.8)) {
+					unique.insert(s);
+				}
+				for (auto& g : groups) {
+					for (auto& d : g.defs) {
+						if (chance(0.5)) {
+							unique.insert(derive(s, d));
+						}
+					}
+				}
+			}
+			std::vector<String> words(unique.begin(), unique.end());
+			std::shuffle(words.begin(), words.end(), rng);
+
+			std::ofstream wrd(prefix + ".wrd");
+			wrd << words.size() << "\n";
+			for (auto& w : words) {
+				wrd << w << "\n";
+			}
+
+			std::ofstream aff(prefix + ".aff");
+			aff << "W/A,A!\n\n";
+			for (auto& g : groups) {
+				aff << g.name << " (" << g.header << ") {\n";
+				for (auto& d : g.defs) {
+					aff << d.replace << "\t" << d.affix << "\t" << d.score << "\n";
+				}
+				aff << "}\n\n";
+			}
+		}
+};
+
+int main(int argc, char * argv[]) {
+	if (argc != 3) {
+		std::cerr << "Usage: gen-corpus seed output-prefix" << std::endl;
+		return 1;
+	}
+	Generator g(std::stoul(argv[1]));
+	g.write(argv[2]);
+	return 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * This file is part of xmunch
+ * Copyright (C) 2018 Gabriel Margiani
+ *
+ * xmunch is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * xmunch is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xmunch.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+// Look words up in a query index written by xmunch --query-index.
+
+#include "query-index.h"
+
+#include <iostream>
+#include <string>
+
+using namespace xmunch;
+
+namespace {
+	// Prints a line per stem and group the word is derived from: the word,
+	// the stem and the group, which is empty if the word is a stem or isn't
+	// derived from one. Words not in the index are printed alone.
+	bool query(const QueryIndex& qi, const std::string& word) {
+		QueryIndex::Range r = qi.find(word);
+		if (r.first == r.second) {
+			std::cout << word << '\n';
+			return false;
+		}
+		for (auto e = r.first; e != r.second; ++e) {
+			std::cout << word << '\t' << qi.getStem(*e) << '\t' << qi.getGroup(*e) << '\n';
+		}
+		return true;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2 || std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h") {
+		std::cerr << "Usage: xmunch-query index [word...]\n"
+			<< "index is a file written by xmunch --query-index, without words, they are read from standard input,\n"
+			<< "one per line. Prints the word, its stem and the affix group deriving it, separated by tabs." << std::endl;
+		return argc < 2 ? 1 : 0;
+	}
+
+	QueryIndex qi;
+	if (!qi.open(argv[1])) {
+		return 1;
+	}
+
+	std::ios::sync_with_stdio(false);
+	bool found = true;
+	if (argc > 2) {
+		for (int i = 2; i < argc; i++) {
+			found = query(qi, argv[i]) && found;
+		}
+	} else {
+		std::string w;
+		while (std::getline(std::cin, w)) {
+			found = query(qi, w) && found;
+		}
+	}
+	return found ? 0 : 2;
+}